@@ -26,7 +26,7 @@ class SyntheticDataFeed : public ParticleFilterDataFeed<SphereFunctionState> {
     SyntheticDataFeed() {}
     ~SyntheticDataFeed() override = default;
 
-    void progress_feed() override {}
+    void progress_feed(int) override {}
 
     [[nodiscard]] SphereFunctionState get_state() override {
         SphereFunctionState local_state;
@@ -49,17 +49,15 @@ class InitialiseModelParticles : public ParticlesInitialiser<SphereFunction> {
         std::shared_ptr<std::vector<SphereFunction>> particles =
             std::make_shared<std::vector<SphereFunction>>(std::vector<SphereFunction>(number_of_particles));
 
-        std::random_device rd;
-        std::array<int, std::mt19937::state_size> seed_data;
-        std::generate_n(seed_data.data(), seed_data.size(), std::ref(rd));
-        std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-        std::shared_ptr<std::mt19937> generator = std::make_shared<std::mt19937>(std::mt19937(seq));
-
-        std::uniform_real_distribution<float> distribution = std::uniform_real_distribution<float>(-50, 50);
+        std::uint32_t random_seed = CounterRandomEngine::random_seed();
 
 #pragma omp parallel for shared(particles)
         for (unsigned long i = 0; i < number_of_particles; i++) {
-            (*particles).at(i) = SphereFunction(distribution(*generator), distribution(*generator));
+            CounterRandomEngine generator(random_seed, 0, static_cast<std::uint32_t>(i));
+            std::uniform_real_distribution<float> distribution = std::uniform_real_distribution<float>(-50, 50);
+            float x = distribution(generator);
+            float y = distribution(generator);
+            (*particles).at(i) = SphereFunction(x, y, generator());
         }
         return particles;
     }
@@ -70,14 +68,9 @@ class StationSimParticleFit : public ParticleFit<SphereFunction, SphereFunctionS
     [[nodiscard]] float calculate_particle_fit(const SphereFunction &particle,
                                                const SphereFunctionState &measured_state) const override {
 
-        int world_rank;
-        MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
-        int world_size;
-        MPI_Comm_size(MPI_COMM_WORLD, &world_size);
-
         float distance = 0;
 
-        SphereFunctionState particle_state = particle.get_state();
+        SphereFunctionState particle_state = particle.get_state_view();
 
         distance += powf(particle_state.x, 2);
         distance += powf(particle_state.y, 2);
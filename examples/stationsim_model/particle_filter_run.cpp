@@ -24,18 +24,14 @@ using namespace station_sim;
 
 class SyntheticDataFeed : public ParticleFilterDataFeed<ModelState> {
   private:
-    std::shared_ptr<std::mt19937> generator;
+    std::uint32_t random_seed;
     std::normal_distribution<float> float_normal_distribution;
 
   public:
     station_sim::Model base_model;
 
     SyntheticDataFeed(station_sim::Model base_model) {
-        std::random_device rd;
-        std::array<int, std::mt19937::state_size> seed_data;
-        std::generate_n(seed_data.data(), seed_data.size(), std::ref(rd));
-        std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-        generator = std::make_shared<std::mt19937>(std::mt19937(seq));
+        random_seed = CounterRandomEngine::random_seed();
 
         float target_model_std = 1.0;
         float_normal_distribution = std::normal_distribution<float>(0.0, powf(target_model_std, 2));
@@ -49,7 +45,7 @@ class SyntheticDataFeed : public ParticleFilterDataFeed<ModelState> {
         this->base_model.set_state(base_model_state);
     }
 
-    void progress_feed() override { base_model.step(); }
+    void progress_feed(int steps) override { base_model.advance(steps); }
 
     [[nodiscard]] ModelState get_state() override {
         int world_rank;
@@ -77,11 +73,14 @@ class SyntheticDataFeed : public ParticleFilterDataFeed<ModelState> {
 
         model_state.agents_desired_location.resize(base_model.agents.size());
 
-        // Add noise to the synthetic target data
+        // Add noise to the synthetic target data, the same noise for every
+        // read of the state of a step
+        CounterRandomEngine generator(random_seed, 0, static_cast<std::uint32_t>(base_model.step_id));
+        float_normal_distribution.reset();
         for (unsigned long i = 0; i < base_model.agents.size(); i++) {
             Point2D agent_location = base_model.agents.at(i).get_agent_location();
-            measured_state.at(i).x = agent_location.x + float_normal_distribution(*generator);
-            measured_state.at(i).y = agent_location.y + float_normal_distribution(*generator);
+            measured_state.at(i).x = agent_location.x + float_normal_distribution(generator);
+            measured_state.at(i).y = agent_location.y + float_normal_distribution(generator);
             agent_active_status.at(i) = base_model.agents.at(i).getStatus();
             model_state.agents_desired_location.at(i) = base_model.agents.at(i).get_desired_location();
         }
@@ -124,15 +123,22 @@ class InitialiseModelParticles : public ParticlesInitialiser<Model> {
         ModelParameters model_parameters = ModelParameters();
         model_parameters.set_population_total(40);
         model_parameters.set_do_print(false);
+        std::shared_ptr<const station_sim::Scenario> scenario = station_sim::Scenario::create(model_parameters);
+
+        int world_rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
 
         std::shared_ptr<std::vector<Model>> particles =
             std::make_shared<std::vector<Model>>(std::vector<Model>(number_of_particles));
-#pragma omp parallel for shared(particles)
+#pragma omp parallel for shared(particles, scenario)
         for (unsigned long i = 0; i < number_of_particles; i++) {
-            station_sim::Model model = station_sim::Model(0, model_parameters);
+            // The model id keys the random numbers of the particle, so it has
+            // to be unique across the processes
+            int particle_id = world_rank * number_of_particles + static_cast<int>(i);
+            station_sim::Model model = station_sim::Model(particle_id, scenario);
             model.set_state(base_model_state);
 
-            (*particles).at(i) = Model(model);
+            (*particles).at(i) = model.clone_particle();
         }
         return particles;
     }
@@ -142,18 +148,13 @@ class StationSimParticleFit : public ParticleFit<Model, ModelState> {
   public:
     [[nodiscard]] float calculate_particle_fit(const Model &particle, const ModelState &measured_state) const override {
 
-        int world_rank;
-        MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
-        int world_size;
-        MPI_Comm_size(MPI_COMM_WORLD, &world_size);
-
         float distance = 0;
 
-        ModelState particle_state = particle.get_state();
-        for (unsigned long i = 0; i < particle_state.agents_location.size(); i++) {
+        ModelStateView particle_state = particle.get_state_view();
+        for (unsigned long i = 0; i < particle_state.size(); i++) {
             if (measured_state.agent_active_status.at(i) == AgentStatus::active) {
-                distance += powf(particle_state.agents_location.at(i).x - measured_state.agents_location.at(i).x, 2);
-                distance += powf(particle_state.agents_location.at(i).y - measured_state.agents_location.at(i).y, 2);
+                distance += powf(particle_state.agent_location(i).x - measured_state.agents_location.at(i).x, 2);
+                distance += powf(particle_state.agent_location(i).y - measured_state.agents_location.at(i).y, 2);
             }
         }
 
@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef PARTICLE_FILTER_COUNTERRANDOMENGINE_HPP
+#define PARTICLE_FILTER_COUNTERRANDOMENGINE_HPP
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+namespace particle_filter {
+    /// \brief Counter-based random number engine (Philox-4x32-10)
+    ///
+    /// The numbers are a function of a key, made of a seed and a stream, and
+    /// of a counter, made of three ids chosen by the caller (e.g. model id,
+    /// agent id and step) and the index of the draw. An engine is cheap to
+    /// create, so a new one is made every time random numbers are needed, and
+    /// the numbers do not depend on the order in which the engines are used.
+    /// Satisfies UniformRandomBitGenerator, so it works with the standard
+    /// distributions.
+    class CounterRandomEngine {
+      public:
+        using result_type = std::uint32_t;
+
+      private:
+        std::array<std::uint32_t, 2> key;
+        std::array<std::uint32_t, 4> counter;
+        std::array<std::uint32_t, 4> block{};
+        unsigned int block_position = 4;
+
+        static constexpr std::uint32_t multiplier_0 = 0xD2511F53;
+        static constexpr std::uint32_t multiplier_1 = 0xCD9E8D57;
+        static constexpr std::uint32_t weyl_0 = 0x9E3779B9;
+        static constexpr std::uint32_t weyl_1 = 0xBB67AE85;
+        static constexpr int rounds = 10;
+
+      public:
+        CounterRandomEngine(std::uint32_t seed, std::uint32_t stream, std::uint32_t id_0 = 0, std::uint32_t id_1 = 0,
+                            std::uint32_t id_2 = 0)
+            : key{seed, stream}, counter{id_0, id_1, id_2, 0} {}
+
+        static constexpr result_type min() { return std::numeric_limits<result_type>::min(); }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        result_type operator()() {
+            if (block_position == 4) {
+                generate_block();
+                counter[3]++;
+                block_position = 0;
+            }
+            return block[block_position++];
+        }
+
+        /// \brief Seed which is different on every run, for when no seed is given
+        [[nodiscard]] static std::uint32_t random_seed() {
+            std::random_device random_device;
+            return random_device();
+        }
+
+      private:
+        void generate_block() {
+            std::array<std::uint32_t, 4> state = counter;
+            std::array<std::uint32_t, 2> round_key = key;
+            for (int round = 0; round < rounds; round++) {
+                std::uint64_t product_0 = static_cast<std::uint64_t>(multiplier_0) * state[0];
+                std::uint64_t product_1 = static_cast<std::uint64_t>(multiplier_1) * state[2];
+                state = {static_cast<std::uint32_t>(product_1 >> 32) ^ state[1] ^ round_key[0],
+                         static_cast<std::uint32_t>(product_1),
+                         static_cast<std::uint32_t>(product_0 >> 32) ^ state[3] ^ round_key[1],
+                         static_cast<std::uint32_t>(product_0)};
+                round_key[0] += weyl_0;
+                round_key[1] += weyl_1;
+            }
+            block = state;
+        }
+    };
+} // namespace particle_filter
+
+#endif // PARTICLE_FILTER_COUNTERRANDOMENGINE_HPP
@@ -15,13 +15,28 @@ namespace particle_filter {
     template <class StateType>
     class Particle {
       public:
+        // Read-only state of a particle used to fit and average it. Particles
+        // which can expose their state without copying it redefine the type
+        // and `get_state_view`, `get_state` is kept for sending the state to
+        // other ranks.
+        using StateViewType = StateType;
+
         Particle() = default;
         virtual ~Particle() = default;
 
         [[nodiscard]] virtual bool is_active() const = 0;
-        [[nodiscard]] virtual const StateType get_state() const = 0;
+        [[nodiscard]] virtual StateType get_state() const = 0;
+        [[nodiscard]] StateViewType get_state_view() const { return get_state(); }
         virtual void perturb_state(float standard_deviation) = 0;
         virtual void step() = 0;
+
+        // Same as calling `step` `steps` times, for the particles which can
+        // run several steps faster than one at a time
+        virtual void advance(int steps) {
+            for (int i = 0; i < steps; i++) {
+                step();
+            }
+        }
     };
 } // namespace particle_filter
 
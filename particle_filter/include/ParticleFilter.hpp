@@ -10,17 +10,28 @@
 #define PARTICLE_FILTER_PARTICLEFILTER_HPP
 
 #include "Chronos.hpp"
+#include "CounterRandomEngine.hpp"
 #include "ParticleFilterDataFeed.hpp"
 #include "ParticleFilterFileOutput.hpp"
 #include "ParticleFilterStatistics.hpp"
 #include "ParticleFit.hpp"
+#include "ParticleRedistribution.hpp"
+#include "ParticleResampler.hpp"
 #include "ParticlesInitialiser.hpp"
 #include "mpi.h"
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
 #include <numeric>
 #include <random>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace particle_filter {
@@ -33,22 +44,27 @@ namespace particle_filter {
         float particle_std;
         bool do_save;
         bool do_resample;
+        float resample_threshold;
+        double effective_sample_size;
 
         int steps_run;
         int total_number_of_particle_steps_to_run;
         int window_counter;
 
-        std::shared_ptr<std::mt19937> generator;
+        std::uint32_t random_seed;
         std::normal_distribution<float> float_normal_distribution;
 
         std::shared_ptr<std::vector<ParticleType>> particles;
         std::vector<float> particles_weights;
+        // Logarithms of the weights, which are accumulated between resamplings
+        std::vector<double> log_weights;
         std::shared_ptr<ParticleFilterDataFeed<StateType>> particle_filter_data_feed;
         std::shared_ptr<ParticleFilterStatistics<ParticleType, StateType>> particle_filter_statistics;
 
         // ParticleFilterFileOutput<StateType> particle_filter_file_output;
 
         std::shared_ptr<ParticleFit<ParticleType, StateType>> particle_fit;
+        std::shared_ptr<ParticleResampler> particle_resampler = std::make_shared<SystematicResampler>();
 
       public:
         ParticleFilter() = delete;
@@ -81,21 +97,22 @@ namespace particle_filter {
             this->particle_std = 0.25;
             this->do_save = true;
             this->do_resample = true;
+            this->resample_threshold = 0.5;
 
             steps_run = 0;
             this->total_number_of_particle_steps_to_run = total_number_of_particle_steps_to_run;
             window_counter = 0;
 
-            std::random_device rd;
-            std::array<int, std::mt19937::state_size> seed_data;
-            std::generate_n(seed_data.data(), seed_data.size(), std::ref(rd));
-            std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-            generator = std::make_shared<std::mt19937>(std::mt19937(seq));
+            // The ranks draw the copies of their particles from the same
+            // random numbers, so they need the same seed
+            random_seed = CounterRandomEngine::random_seed();
+            MPI_Bcast(&random_seed, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
 
             float_normal_distribution = std::normal_distribution<float>(0.0, particle_std);
 
             particles_weights = std::vector<float>(this->number_of_particles);
-            std::fill(particles_weights.begin(), particles_weights.end(), 1.0);
+            log_weights = std::vector<double>(this->number_of_particles);
+            reset_weights();
 
             Chronos::Timer particles_initialisation_timer("Particles initialisation timer");
             particles_initialisation_timer.start();
@@ -112,12 +129,36 @@ namespace particle_filter {
 
         ~ParticleFilter() = default;
 
+        /// \brief Set the seed of the random numbers of the resampling, which is random by default
+        ///
+        /// All the ranks must call it, and the seed of rank 0 is used on all of them.
+        void set_random_seed(std::uint32_t value) {
+            random_seed = value;
+            MPI_Bcast(&random_seed, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+        }
+
+        /// \brief Set the scheme drawing the particles kept by the resampling, systematic by default
+        void set_resampler(std::shared_ptr<ParticleResampler> value) { particle_resampler = std::move(value); }
+
+        /// \brief Set the fraction of the particles under which the effective sample size triggers a resampling, 0.5 by
+        /// default
+        void set_resample_threshold(float value) {
+            if (value < 0 || value > 1) {
+                throw std::invalid_argument("resample_threshold must be between 0 and 1!");
+            }
+            resample_threshold = value;
+        }
+
+        /// \brief Effective sample size of the particles of all the ranks after the last reweighting
+        [[nodiscard]] double get_effective_sample_size() const { return effective_sample_size; }
+
         /// \brief Step Particle Filter
         ///
         /// Loop through process. Predict the base model and particles
         /// forward. If the resample window has been reached, reweight particles
-        /// based on distance to base model and resample particles choosing
-        /// particles with higher particles_weights. Then save and animate the data. When
+        /// based on distance to base model and, when their weights have become
+        /// too uneven, resample particles choosing particles with higher
+        /// particles_weights and perturb them. Then save and animate the data. When
         /// done, plot save figures. Note: if the multi_step is True then
         /// predict() is called once, but steps the model forward until the next
         /// window. This is quicker but means that animations and saves will
@@ -148,8 +189,10 @@ namespace particle_filter {
 
                     if (do_resample) {
                         reweight();
-                        resample();
-                        perturb_particles(number_of_steps);
+                        if (needs_resampling()) {
+                            resample();
+                            perturb_particles(number_of_steps);
+                        }
                     }
                 }
 
@@ -171,9 +214,7 @@ namespace particle_filter {
         /// particles variable.
         /// \param number_of_steps The number of iterations to step (usually either 1, or the  resample window)
         void predict(int number_of_steps) {
-            for (int i = 0; i < number_of_steps; i++) {
-                particle_filter_data_feed->progress_feed();
-            }
+            particle_filter_data_feed->progress_feed(number_of_steps);
 
 #pragma omp parallel for shared(particles)
             for (int i = 0; i < (*particles).size(); i++) {
@@ -197,11 +238,7 @@ namespace particle_filter {
         ///
         /// \param model Μodel object associated with the particle that needs to be stepped
         /// \param num_iter The number of iterations to step
-        void step_particle(ParticleType &particle, int num_iter) {
-            for (int i = 0; i < num_iter; i++) {
-                particle.step();
-            }
-        }
+        void step_particle(ParticleType &particle, int num_iter) { particle.advance(num_iter); }
 
         void perturb_particle(ParticleType &particle, int num_iter) {
             for (int i = 0; i < num_iter; i++) {
@@ -209,18 +246,61 @@ namespace particle_filter {
             }
         }
 
+        /// \brief Multiply the weight of every particle by its fit to the measured state
+        ///
+        /// The weights are kept as logarithms, normalised with the log-sum-exp of the weights of all the ranks, so that
+        /// the products of many small fits do not underflow.
         void reweight() {
             StateType measured_state = particle_filter_data_feed->get_state();
 
-            std::vector<float> distance;
-            for (int i = 0; i < (*particles).size(); i++) {
-                distance.push_back(particle_fit->calculate_particle_fit((*particles).at(i), measured_state));
+            double max_log_weight = -std::numeric_limits<double>::infinity();
+#pragma omp parallel for reduction(max : max_log_weight)
+            for (int i = 0; i < number_of_particles; i++) {
+                float fit = particle_fit->calculate_particle_fit((*particles).at(i), measured_state);
+                log_weights[i] += fit > 0 ? std::log(static_cast<double>(fit))
+                                          : -std::numeric_limits<double>::infinity();
+                max_log_weight = std::max(max_log_weight, log_weights[i]);
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &max_log_weight, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+            if (std::isinf(max_log_weight)) {
+                reset_weights();
+                return;
             }
 
-            //            std::transform(distance.begin(), distance.end(), particles_weights.begin(), [](float distance)
-            //            -> float {
-            //                return static_cast<float>(powf(1.0 / (distance + 1e-9), 2));
-            //            });
+            std::vector<double> weights(static_cast<unsigned long>(number_of_particles));
+#pragma omp parallel for
+            for (int i = 0; i < number_of_particles; i++) {
+                weights[i] = std::exp(log_weights[i] - max_log_weight);
+            }
+
+            // The sums of the ranks are added in rank order on every rank, so
+            // that all the ranks take the same resampling decision
+            int world_size;
+            MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+            std::array<double, 2> rank_sums = {
+                std::accumulate(weights.begin(), weights.end(), 0.0),
+                std::inner_product(weights.begin(), weights.end(), weights.begin(), 0.0)};
+            std::vector<double> all_rank_sums(static_cast<unsigned long>(2 * world_size));
+            MPI_Allgather(rank_sums.data(), 2, MPI_DOUBLE, all_rank_sums.data(), 2, MPI_DOUBLE, MPI_COMM_WORLD);
+            double sum = 0;
+            double sum_squares = 0;
+            for (int r = 0; r < world_size; r++) {
+                sum += all_rank_sums[2 * r];
+                sum_squares += all_rank_sums[2 * r + 1];
+            }
+
+            double log_sum = max_log_weight + std::log(sum);
+#pragma omp parallel for
+            for (int i = 0; i < number_of_particles; i++) {
+                log_weights[i] -= log_sum;
+                particles_weights[i] = static_cast<float>(weights[i] / sum);
+            }
+            effective_sample_size = sum * sum / sum_squares;
+        }
+
+        /// \brief Whether the effective sample size has dropped under the threshold
+        [[nodiscard]] bool needs_resampling() const {
+            return effective_sample_size < resample_threshold * static_cast<double>(total_number_of_particles());
         }
 
         void resample() {
@@ -229,124 +309,110 @@ namespace particle_filter {
             int world_size;
             MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
-            std::vector<int> indexes(number_of_particles * world_size);
-
-            if (world_rank == 0) {
-                // Get weights from all processes
-                std::vector<std::vector<float>> global_particle_weights(world_size,
-                                                                        std::vector<float>(number_of_particles));
-
-                for (int i = 1; i < world_size; i++) {
-                    std::vector<float> particles_weights_temp(number_of_particles);
-
-                    MPI_Recv(particles_weights_temp.data(), number_of_particles, MPI_FLOAT, i, 0, MPI_COMM_WORLD,
-                             MPI_STATUS_IGNORE);
-
-                    for (int j = 0; j < particles_weights_temp.size(); j++) {
-                        global_particle_weights.at(i).at(j) = particles_weights_temp.at(j);
-                    }
-                }
-
-                double sum = std::reduce(particles_weights.begin(), particles_weights.end(), 0.0);
-
-                for (int i = 1; i < world_size; i++) {
-                    for (size_t j = 0; j < global_particle_weights.at(i).size(); j++) {
-                        sum = std::reduce(global_particle_weights.at(i).begin(), global_particle_weights.at(i).end(),
-                                          sum);
-                    }
-                }
-
-                // Normalise particle_weights
-                std::for_each(particles_weights.begin(), particles_weights.end(),
-                              [sum](float &weight) { weight = static_cast<float>(static_cast<double>(weight) / sum); });
-
-                for (int i = 1; i < world_size; i++) {
-                    for (size_t j = 0; j < global_particle_weights.at(i).size(); j++) {
-                        std::for_each(
-                            global_particle_weights.at(i).begin(), global_particle_weights.at(i).end(),
-                            [sum](float &weight) { weight = static_cast<float>(static_cast<double>(weight) / sum); });
-                    }
+            // Every rank draws the copies of its own particles, with the same
+            // random numbers, and gathers the copies of all the particles
+            std::vector<int> counts;
+            particle_resampler->draw_counts(particles_weights, MPI_COMM_WORLD, random_seed,
+                                            static_cast<std::uint32_t>(window_counter), counts);
+            std::vector<int> global_counts(static_cast<unsigned long>(number_of_particles * world_size));
+            MPI_Allgather(counts.data(), number_of_particles, MPI_INT, global_counts.data(), number_of_particles,
+                          MPI_INT, MPI_COMM_WORLD);
+            ParticleRedistribution particle_redistribution(global_counts, number_of_particles);
+            std::vector<int> indexes;
+            particle_redistribution.place_copies(world_rank, indexes);
+
+            // Particle `i` takes the state of particle `indexes[i]`. The kept
+            // particles keep their states, so the local copies are made from
+            // them. A particle is sent at most once to a rank, which makes all
+            // its copies there.
+            int first_particle = world_rank * number_of_particles;
+            std::map<int, StateType> received_states;
+            exchange_states(particle_redistribution.get_transfers(), received_states);
+
+#pragma omp parallel for shared(received_states, particles)
+            for (int i = 0; i < number_of_particles; i++) {
+                int source = indexes.at(i);
+                if (source == first_particle + i) {
+                    continue;
                 }
 
-                // Calculate cummulative sum
-                std::vector<float> cumsum(particles_weights.size() * world_size);
-                cumsum.at(0) = particles_weights.at(0);
-
-                for (size_t i = 1; i < particles_weights.size(); i++) {
-                    cumsum.at(i) = cumsum.at(i - 1) + particles_weights.at(i);
-                }
-
-                for (int i = 1; i < world_size; i++) {
-                    for (size_t j = 0; j < particles_weights.size(); j++) {
-                        cumsum.at(i * number_of_particles + j) =
-                            cumsum.at(i * number_of_particles + j - 1) + global_particle_weights.at(i).at(j);
-                    }
+                if (source / number_of_particles == world_rank) {
+                    update_agents_locations_of_model((*particles).at(source - first_particle).get_state(),
+                                                     (*particles).at(i));
+                } else {
+                    update_agents_locations_of_model(received_states.at(source), (*particles).at(i));
                 }
+            }
 
-                float max_cumsum = *(std::max_element(cumsum.begin(), cumsum.end()));
-
-                // Sampling
-                std::uniform_real_distribution<float> dis(0.0, max_cumsum);
+            // The resampled particles are drawn in proportion to their weights
+            reset_weights();
+        }
 
-                for (int j = 0; j < number_of_particles * world_size; j++) {
-                    float u1 = dis(*generator);
-                    for (int i = 0; i < number_of_particles * world_size; i++) {
-                        if (u1 <= cumsum.at(i)) {
-                            indexes.at(j) = i;
-                            break;
-                        }
-                    }
-                }
+        /// \brief Send the states of the particles of `transfers` from their ranks and receive those sent to this rank
+        ///
+        /// The states sent to a rank are packed into one buffer, in the order of the transfers, and the buffers of
+        /// all the ranks are exchanged at once.
+        void exchange_states(const std::vector<ParticleTransfer> &transfers,
+                             std::map<int, StateType> &received_states) const {
+            int world_rank;
+            MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+            int world_size;
+            MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
-                // send swap indexes vector to all process
-                for (int i = 1; i < world_size; i++) {
-                    MPI_Send(indexes.data(), number_of_particles * world_size, MPI_INT, i, 0, MPI_COMM_WORLD);
+            int first_particle = world_rank * number_of_particles;
+            std::vector<std::vector<char>> rank_buffers(static_cast<unsigned long>(world_size));
+            for (const ParticleTransfer &transfer : transfers) {
+                if (transfer.source / number_of_particles == world_rank) {
+                    (*particles).at(transfer.source - first_particle).get_state().pack(
+                        rank_buffers.at(transfer.rank_destination));
                 }
-            } else {
-                MPI_Send(particles_weights.data(), number_of_particles, MPI_FLOAT, 0, 0, MPI_COMM_WORLD);
-                MPI_Recv(indexes.data(), number_of_particles * world_size, MPI_INT, 0, 0, MPI_COMM_WORLD,
-                         MPI_STATUS_IGNORE);
             }
 
-            std::vector<StateType> particles_states(number_of_particles);
-#pragma omp parallel for shared(particles_states, particles)
-            for (unsigned long i = 0; i < particles_states.size(); i++) {
-                particles_states.at(i) = (*particles).at(i).get_state();
+            std::vector<char> send_buffer;
+            std::vector<int> send_bytes(static_cast<unsigned long>(world_size));
+            std::vector<int> receive_bytes(static_cast<unsigned long>(world_size));
+            for (int r = 0; r < world_size; r++) {
+                send_buffer.insert(send_buffer.end(), rank_buffers[r].begin(), rank_buffers[r].end());
+                send_bytes[r] = static_cast<int>(rank_buffers[r].size());
             }
-
-            std::vector<StateType> particle_states_temp(number_of_particles);
-
-            for (unsigned long i = 0; i < indexes.size(); i++) {
-
-                int rank_source = std::floor(i / number_of_particles);
-                int rank_destination = std::floor(indexes.at(i) / number_of_particles);
-
-                // Swap is in the current process
-                if (rank_source == world_rank && rank_destination == world_rank) {
-                    particle_states_temp.at(i - (world_rank * number_of_particles)) =
-                        particles_states.at(indexes.at(i));
-                }
-
-                // Target is in other process
-                if (rank_source == world_rank && rank_destination != world_rank) {
-                    // Send the particle state to another process
-                    particles_states.at(i - (world_rank * number_of_particles)).mpi_send_state(rank_destination);
-                }
-
-                // Source is in other process and target is in the current process
-                if (rank_source != world_rank && rank_destination == world_rank) {
-                    particle_states_temp.at(indexes.at(i) - (world_rank * number_of_particles))
-                        .mpi_receive_state(rank_source);
+            MPI_Alltoall(send_bytes.data(), 1, MPI_INT, receive_bytes.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+            std::vector<int> send_displacements(static_cast<unsigned long>(world_size), 0);
+            std::vector<int> receive_displacements(static_cast<unsigned long>(world_size), 0);
+            std::partial_sum(send_bytes.begin(), send_bytes.end() - 1, send_displacements.begin() + 1);
+            std::partial_sum(receive_bytes.begin(), receive_bytes.end() - 1, receive_displacements.begin() + 1);
+
+            std::vector<char> receive_buffer(
+                static_cast<unsigned long>(receive_displacements.back() + receive_bytes.back()));
+            MPI_Alltoallv(send_buffer.data(), send_bytes.data(), send_displacements.data(), MPI_BYTE,
+                          receive_buffer.data(), receive_bytes.data(), receive_displacements.data(), MPI_BYTE,
+                          MPI_COMM_WORLD);
+
+            // The transfers are ordered by particle, so the received states are
+            // ordered by rank and then by transfer, as in the receive buffer
+            std::size_t position = 0;
+            for (const ParticleTransfer &transfer : transfers) {
+                if (transfer.rank_destination == world_rank) {
+                    position = received_states[transfer.source].unpack(receive_buffer, position);
                 }
             }
+        }
 
-#pragma omp parallel for shared(particles_states, particles)
-            for (int i = 0; i < particle_states_temp.size(); i++) {
-                update_agents_locations_of_model(particle_states_temp.at(i), (*particles).at(i));
-            }
+        /// \brief Give the same weight to all the particles
+        void reset_weights() {
+            std::fill(log_weights.begin(), log_weights.end(), 0.0);
+            std::fill(particles_weights.begin(), particles_weights.end(),
+                      1.0f / static_cast<float>(total_number_of_particles()));
+            effective_sample_size = total_number_of_particles();
+        }
+
+        [[nodiscard]] int total_number_of_particles() const {
+            int world_size;
+            MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+            return number_of_particles * world_size;
         }
 
-        void update_agents_locations_of_model(StateType particle_state, ParticleType &particle) {
+        void update_agents_locations_of_model(const StateType &particle_state, ParticleType &particle) {
             particle.set_state(particle_state);
         }
 
@@ -16,7 +16,8 @@ namespace particle_filter {
         ParticleFilterDataFeed() = default;
         virtual ~ParticleFilterDataFeed() = default;
 
-        virtual void progress_feed() = 0;
+        // Move the feed `steps` steps forward
+        virtual void progress_feed(int steps) = 0;
         [[nodiscard]] virtual StateType get_state() = 0;
         virtual void print_statistics() = 0;
     };
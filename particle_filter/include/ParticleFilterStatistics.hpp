@@ -19,6 +19,9 @@
 namespace particle_filter {
     template <class ParticleType, class StateType>
     class ParticleFilterStatistics {
+      public:
+        using StateViewType = typename ParticleType::StateViewType;
+
       protected:
         std::shared_ptr<ParticleFilterDataFeed<StateType>> particle_filter_data_feed;
         std::vector<std::vector<float>> absolute_means_states;
@@ -39,9 +42,9 @@ namespace particle_filter {
         virtual float calculate_absolute_mean_error(std::vector<float> weighted_mean) = 0;
         virtual float calculate_weighted_mean_error(std::vector<float> weighted_mean) = 0;
 
-        virtual std::vector<float> calculate_absolute_average(const std::vector<StateType> &particles_states) = 0;
+        virtual std::vector<float> calculate_absolute_average(const std::vector<StateViewType> &particles_states) = 0;
 
-        virtual std::vector<float> calculate_weighted_average(const std::vector<StateType> &particles_states,
+        virtual std::vector<float> calculate_weighted_average(const std::vector<StateViewType> &particles_states,
                                                               const std::vector<float> &weights) = 0;
 
         //        virtual std::vector<float> calculate_variance(const Model &base_model, const std::vector<Model>
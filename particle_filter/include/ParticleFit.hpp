@@ -15,6 +15,10 @@ namespace particle_filter {
         ParticleFit() = default;
         virtual ~ParticleFit() = default;
 
+        // Fits are calculated for every particle on every reweight, so the
+        // state of `particle` should be read through its `get_state_view`.
+        // They are calculated in parallel threads, so they must be thread
+        // safe and must not call MPI.
         [[nodiscard]] virtual float calculate_particle_fit(const ParticleType &particle,
                                                            const StateType &measured_state) const = 0;
     };
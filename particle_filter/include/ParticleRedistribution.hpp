@@ -0,0 +1,125 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef PARTICLE_FILTER_PARTICLEREDISTRIBUTION_HPP
+#define PARTICLE_FILTER_PARTICLEREDISTRIBUTION_HPP
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace particle_filter {
+    /// \brief Copies of a particle sent to another rank
+    struct ParticleTransfer {
+        int source;
+        int rank_destination;
+        int copies;
+    };
+
+    /// \brief Plan of the moves of the copies drawn by a resampling between the ranks
+    ///
+    /// Every rank holds `particles_per_rank` particles, numbered by rank. A kept particle stays where it is with as many
+    /// of its copies as its rank has room for. Only the copies which do not fit on the rank of their particle are sent,
+    /// to the ranks with room left in rank order, and a particle is sent at most once to each rank, which makes its
+    /// copies there. The plan only depends on the copies of all the particles, so every rank makes the same plan.
+    class ParticleRedistribution {
+      public:
+        ParticleRedistribution() = delete;
+
+        ParticleRedistribution(const std::vector<int> &counts, int particles_per_rank) {
+            if (particles_per_rank <= 0) {
+                throw std::invalid_argument("particles_per_rank must be positive!");
+            }
+            if (counts.size() % static_cast<unsigned long>(particles_per_rank) != 0) {
+                throw std::invalid_argument("counts must have particles_per_rank particles per rank!");
+            }
+            if (std::any_of(counts.begin(), counts.end(), [](int count) { return count < 0; })) {
+                throw std::invalid_argument("counts must not be negative!");
+            }
+            if (std::accumulate(counts.begin(), counts.end(), 0L) != static_cast<long>(counts.size())) {
+                throw std::invalid_argument("counts must add up to the number of particles!");
+            }
+
+            this->particles_per_rank = particles_per_rank;
+            kept_counts = counts;
+            int ranks_number = static_cast<int>(counts.size()) / particles_per_rank;
+
+            // Copies over or under the particles of each rank
+            std::vector<int> excess_copies(static_cast<unsigned long>(ranks_number), -particles_per_rank);
+            for (unsigned long i = 0; i < counts.size(); i++) {
+                excess_copies[i / particles_per_rank] += counts[i];
+            }
+
+            // The copies sent are taken beyond the first one of each particle.
+            // A rank has at most as many kept particles as its quota, so these
+            // copies are always enough.
+            int rank_destination = 0;
+            for (int rank = 0; rank < ranks_number; rank++) {
+                for (int i = rank * particles_per_rank; excess_copies[rank] > 0; i++) {
+                    int copies = std::min(kept_counts[i] - 1, excess_copies[rank]);
+                    while (copies > 0) {
+                        while (excess_copies[rank_destination] >= 0) {
+                            rank_destination++;
+                        }
+                        int sent_copies = std::min(copies, -excess_copies[rank_destination]);
+                        transfers.push_back({i, rank_destination, sent_copies});
+                        kept_counts[i] -= sent_copies;
+                        excess_copies[rank] -= sent_copies;
+                        excess_copies[rank_destination] += sent_copies;
+                        copies -= sent_copies;
+                    }
+                }
+            }
+        }
+
+        /// \brief Copies sent between the ranks, ordered by their particle
+        [[nodiscard]] const std::vector<ParticleTransfer> &get_transfers() const { return transfers; }
+
+        /// \brief Index of the particle whose state each particle of `rank` takes
+        ///
+        /// A particle which is kept keeps its own state. The particles which are dropped take the states of the copies
+        /// kept on the rank and then of the copies received, in the order of the transfers.
+        void place_copies(int rank, std::vector<int> &indexes) const {
+            int first_particle = rank * particles_per_rank;
+            indexes.assign(static_cast<unsigned long>(particles_per_rank), -1);
+            for (int i = 0; i < particles_per_rank; i++) {
+                if (kept_counts[first_particle + i] > 0) {
+                    indexes[i] = first_particle + i;
+                }
+            }
+
+            unsigned long free_slot = 0;
+            auto place = [&indexes, &free_slot](int source, int copies) {
+                for (int copy = 0; copy < copies; copy++) {
+                    while (indexes[free_slot] >= 0) {
+                        free_slot++;
+                    }
+                    indexes[free_slot] = source;
+                }
+            };
+            for (int i = 0; i < particles_per_rank; i++) {
+                place(first_particle + i, kept_counts[first_particle + i] - 1);
+            }
+            for (const ParticleTransfer &transfer : transfers) {
+                if (transfer.rank_destination == rank) {
+                    place(transfer.source, transfer.copies);
+                }
+            }
+        }
+
+      private:
+        int particles_per_rank;
+
+        // Copies of each particle made on its own rank
+        std::vector<int> kept_counts;
+        std::vector<ParticleTransfer> transfers;
+    };
+} // namespace particle_filter
+
+#endif // PARTICLE_FILTER_PARTICLEREDISTRIBUTION_HPP
@@ -0,0 +1,293 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef PARTICLE_FILTER_PARTICLERESAMPLER_HPP
+#define PARTICLE_FILTER_PARTICLERESAMPLER_HPP
+
+#include "CounterRandomEngine.hpp"
+#include "mpi.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace particle_filter {
+    /// \brief Cumulative weights of the particles of a rank among the particles of all the ranks
+    ///
+    /// Particle `i` of the rank covers the weights from `cumulative_weights[i - 1]`, or `offset` for the first one, to
+    /// `cumulative_weights[i]`. The last particle of a rank ends exactly where the first one of the next rank starts.
+    struct WeightsPrefixSum {
+        std::vector<double> cumulative_weights;
+        double offset = 0;
+        double total = 0;
+        int first_particle = 0;
+        int particles_number = 0;
+    };
+
+    /// \brief Draws the particles kept by a resampling
+    ///
+    /// Every rank gives the weights of its own particles and gets the number of copies of each of them among the
+    /// resampled particles, as many as there are particles on all the ranks. The random numbers are drawn from
+    /// counter-based engines keyed by the seed and the window, so all the ranks draw the same numbers without
+    /// exchanging them. The work is linear in the number of particles.
+    class ParticleResampler {
+      public:
+        ParticleResampler() = default;
+        virtual ~ParticleResampler() = default;
+
+        virtual void draw_counts(const std::vector<float> &weights, MPI_Comm communicator, std::uint32_t random_seed,
+                                 std::uint32_t window, std::vector<int> &counts) const = 0;
+
+        /// \brief Prefix sum of the weights of the particles of all the ranks of `communicator`
+        ///
+        /// The weights of the rank are summed in parallel by blocks of a fixed size, so the sums do not depend on the
+        /// number of threads, and the ranks only exchange the sum of their weights.
+        template <class T>
+        [[nodiscard]] static WeightsPrefixSum prefix_sum(const std::vector<T> &weights, MPI_Comm communicator) {
+            constexpr long block_size = 4096;
+            auto weights_number = static_cast<long>(weights.size());
+            long blocks_number = (weights_number + block_size - 1) / block_size;
+
+            WeightsPrefixSum prefix_sum;
+            prefix_sum.cumulative_weights.resize(weights.size());
+            std::vector<double> &cumulative_weights = prefix_sum.cumulative_weights;
+            std::vector<double> block_sums(static_cast<unsigned long>(blocks_number) + 1, 0.0);
+
+#pragma omp parallel for
+            for (long block = 0; block < blocks_number; block++) {
+                double sum = 0;
+                for (long i = block * block_size; i < std::min(weights_number, (block + 1) * block_size); i++) {
+                    sum += static_cast<double>(weights[i]);
+                    cumulative_weights[i] = sum;
+                }
+                block_sums[block + 1] = sum;
+            }
+            for (long block = 0; block < blocks_number; block++) {
+                block_sums[block + 1] += block_sums[block];
+            }
+
+            int rank;
+            MPI_Comm_rank(communicator, &rank);
+            int ranks_number;
+            MPI_Comm_size(communicator, &ranks_number);
+            std::array<double, 2> rank_sum = {block_sums.back(), static_cast<double>(weights_number)};
+            std::vector<std::array<double, 2>> rank_sums(static_cast<unsigned long>(ranks_number));
+            MPI_Allgather(rank_sum.data(), 2, MPI_DOUBLE, rank_sums.data(), 2, MPI_DOUBLE, communicator);
+
+            // Every rank adds the sums of the ranks in the same order, so the
+            // bounds of the ranks agree to the last bit
+            double end = 0;
+            for (int r = 0; r < ranks_number; r++) {
+                if (r == rank) {
+                    prefix_sum.offset = prefix_sum.total;
+                    prefix_sum.first_particle = prefix_sum.particles_number;
+                    end = prefix_sum.total + rank_sums[r][0];
+                }
+                prefix_sum.total += rank_sums[r][0];
+                prefix_sum.particles_number += static_cast<int>(rank_sums[r][1]);
+            }
+
+            double offset = prefix_sum.offset;
+#pragma omp parallel for
+            for (long block = 0; block < blocks_number; block++) {
+                for (long i = block * block_size; i < std::min(weights_number, (block + 1) * block_size); i++) {
+                    cumulative_weights[i] += offset + block_sums[block];
+                }
+            }
+            if (!cumulative_weights.empty()) {
+                cumulative_weights.back() = end;
+            }
+            return prefix_sum;
+        }
+
+        /// \brief Index of the particle whose state each particle takes, from the number of copies of every particle
+        ///
+        /// A particle which is kept keeps its own state, so only the particles which are dropped take the state of
+        /// another one.
+        static void place_copies(const std::vector<int> &counts, std::vector<int> &indexes) {
+            indexes.assign(counts.size(), -1);
+            for (unsigned long i = 0; i < counts.size(); i++) {
+                if (counts[i] > 0) {
+                    indexes[i] = static_cast<int>(i);
+                }
+            }
+
+            unsigned long free_slot = 0;
+            for (unsigned long i = 0; i < counts.size(); i++) {
+                for (int copy = 1; copy < counts[i]; copy++) {
+                    while (indexes[free_slot] >= 0) {
+                        free_slot++;
+                    }
+                    indexes[free_slot] = static_cast<int>(i);
+                }
+            }
+        }
+
+      protected:
+        // Uniform number in [0, 1). It is drawn in single precision, so that
+        // `(k + u) / n` stays below 1 in double precision, and kept below 1,
+        // which the standard distribution can round to.
+        [[nodiscard]] static double draw_uniform(CounterRandomEngine &random_engine) {
+            float uniform = std::uniform_real_distribution<float>(0, 1)(random_engine);
+            return static_cast<double>(std::min(uniform, std::nextafter(1.0f, 0.0f)));
+        }
+
+        // Count the increasing points `point(k)`, `k` from `first_point` to
+        // `points_number`, falling within each particle of the rank. The
+        // points before `first_point` are below the weights of the rank. The
+        // points rounded to the total are given to the last particle with a
+        // weight.
+        template <class PointFunction>
+        static void count_points(const WeightsPrefixSum &prefix_sum, int points_number, int first_point,
+                                 PointFunction point, std::vector<int> &counts) {
+            const std::vector<double> &cumulative_weights = prefix_sum.cumulative_weights;
+            counts.assign(cumulative_weights.size(), 0);
+
+            int k = first_point;
+            while (k < points_number && point(k) < prefix_sum.offset) {
+                k++;
+            }
+            for (unsigned long i = 0; i < cumulative_weights.size(); i++) {
+                while (k < points_number && point(k) < cumulative_weights[i]) {
+                    counts[i]++;
+                    k++;
+                }
+            }
+
+            bool is_last_rank =
+                prefix_sum.first_particle + static_cast<int>(cumulative_weights.size()) == prefix_sum.particles_number;
+            if (is_last_rank && k < points_number && !counts.empty()) {
+                unsigned long last = counts.size() - 1;
+                while (last > 0 && cumulative_weights[last] == cumulative_weights[last - 1]) {
+                    last--;
+                }
+                counts[last] += points_number - k;
+            }
+        }
+
+        // First point which can be at or above the offset of the rank, for
+        // points with `point(k)` within `[k, k + 1) * total / points_number`
+        [[nodiscard]] static int first_stratum(const WeightsPrefixSum &prefix_sum, int points_number) {
+            if (prefix_sum.total <= 0) {
+                return 0;
+            }
+            double stratum = std::floor(prefix_sum.offset / prefix_sum.total * points_number) - 2;
+            return static_cast<int>(std::clamp(stratum, 0.0, static_cast<double>(points_number)));
+        }
+    };
+
+    /// \brief Draws the particles independently, with the points sorted on the fly
+    ///
+    /// The points are the normalised partial sums of exponential numbers, so they come out sorted. Every rank draws
+    /// all of them.
+    class MultinomialResampler : public ParticleResampler {
+      public:
+        void draw_counts(const std::vector<float> &weights, MPI_Comm communicator, std::uint32_t random_seed,
+                         std::uint32_t window, std::vector<int> &counts) const override {
+            WeightsPrefixSum weights_prefix_sum = prefix_sum(weights, communicator);
+            int points_number = weights_prefix_sum.particles_number;
+
+            CounterRandomEngine random_engine(random_seed, 0, window);
+            std::exponential_distribution<double> exponential_distribution(1.0);
+            std::vector<double> points(static_cast<unsigned long>(points_number));
+            double sum = 0;
+            for (double &point : points) {
+                sum += exponential_distribution(random_engine);
+                point = sum;
+            }
+            sum += exponential_distribution(random_engine);
+            double scale = weights_prefix_sum.total / sum;
+            std::for_each(points.begin(), points.end(), [scale](double &point) { point *= scale; });
+
+            auto first_point = std::lower_bound(points.begin(), points.end(), weights_prefix_sum.offset);
+            count_points(weights_prefix_sum, points_number, static_cast<int>(first_point - points.begin()),
+                         [&points](int k) { return points[k]; }, counts);
+        }
+    };
+
+    /// \brief Draws one point in each of the equal strata of the weights
+    class StratifiedResampler : public ParticleResampler {
+      public:
+        void draw_counts(const std::vector<float> &weights, MPI_Comm communicator, std::uint32_t random_seed,
+                         std::uint32_t window, std::vector<int> &counts) const override {
+            WeightsPrefixSum weights_prefix_sum = prefix_sum(weights, communicator);
+            int points_number = weights_prefix_sum.particles_number;
+            double stratum_width = weights_prefix_sum.total / points_number;
+
+            // The point of stratum `k` has its own engine, so a rank draws
+            // only the points of its strata
+            auto point = [&](int k) {
+                CounterRandomEngine random_engine(random_seed, 0, window, static_cast<std::uint32_t>(k) + 1);
+                return (k + draw_uniform(random_engine)) * stratum_width;
+            };
+            count_points(weights_prefix_sum, points_number, first_stratum(weights_prefix_sum, points_number), point,
+                         counts);
+        }
+    };
+
+    /// \brief Draws the points of all the strata with the same offset
+    ///
+    /// A particle with a weight of `w` times the mean weight gets `floor(w)` or `ceil(w)` copies.
+    class SystematicResampler : public ParticleResampler {
+      public:
+        void draw_counts(const std::vector<float> &weights, MPI_Comm communicator, std::uint32_t random_seed,
+                         std::uint32_t window, std::vector<int> &counts) const override {
+            WeightsPrefixSum weights_prefix_sum = prefix_sum(weights, communicator);
+            draw_systematic_counts(weights_prefix_sum, weights_prefix_sum.particles_number, random_seed, window,
+                                   counts);
+        }
+
+        static void draw_systematic_counts(const WeightsPrefixSum &weights_prefix_sum, int points_number,
+                                           std::uint32_t random_seed, std::uint32_t window, std::vector<int> &counts) {
+            CounterRandomEngine random_engine(random_seed, 0, window);
+            double start = draw_uniform(random_engine);
+            double stratum_width = weights_prefix_sum.total / points_number;
+            count_points(weights_prefix_sum, points_number, first_stratum(weights_prefix_sum, points_number),
+                         [=](int k) { return (k + start) * stratum_width; }, counts);
+        }
+    };
+
+    /// \brief Keeps `floor(w)` copies of a particle with a weight of `w` times the mean weight, and draws the others
+    /// systematically from the remainders of the weights
+    class ResidualResampler : public ParticleResampler {
+      public:
+        void draw_counts(const std::vector<float> &weights, MPI_Comm communicator, std::uint32_t random_seed,
+                         std::uint32_t window, std::vector<int> &counts) const override {
+            WeightsPrefixSum weights_prefix_sum = prefix_sum(weights, communicator);
+            int particles_number = weights_prefix_sum.particles_number;
+            double scale = weights_prefix_sum.total > 0 ? particles_number / weights_prefix_sum.total : 0;
+
+            std::vector<int> kept_copies(weights.size());
+            std::vector<double> remainders(weights.size());
+            int kept_number = 0;
+            for (unsigned long i = 0; i < weights.size(); i++) {
+                double expected_copies = static_cast<double>(weights[i]) * scale;
+                kept_copies[i] = static_cast<int>(std::floor(expected_copies));
+                remainders[i] = expected_copies - kept_copies[i];
+                kept_number += kept_copies[i];
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &kept_number, 1, MPI_INT, MPI_SUM, communicator);
+
+            WeightsPrefixSum remainders_prefix_sum = prefix_sum(remainders, communicator);
+            int drawn_number = particles_number - kept_number;
+            if (drawn_number > 0) {
+                SystematicResampler::draw_systematic_counts(remainders_prefix_sum, drawn_number, random_seed, window,
+                                                            counts);
+            } else {
+                counts.assign(weights.size(), 0);
+            }
+            for (unsigned long i = 0; i < weights.size(); i++) {
+                counts[i] += kept_copies[i];
+            }
+        }
+    };
+} // namespace particle_filter
+
+#endif // PARTICLE_FILTER_PARTICLERESAMPLER_HPP
@@ -9,14 +9,81 @@
 #ifndef PARTICLE_FILTER_PARTICLESTATE_HPP
 #define PARTICLE_FILTER_PARTICLESTATE_HPP
 
+#include "mpi.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
 namespace particle_filter {
+    /// \brief State of a particle, which can be packed into bytes to be sent to another rank
+    ///
+    /// `unpack` reads what `pack` appended, and sizes the state from it, so a state can be unpacked into a default
+    /// constructed one. The bytes are only meant for the ranks of the same run.
     class ParticleState {
       public:
         ParticleState() = default;
         virtual ~ParticleState() = default;
 
-        virtual void mpi_send_state(int rank_destination){};
-        virtual void mpi_receive_state(int rank_source){};
+        /// \brief Append the state to `buffer`
+        virtual void pack(std::vector<char> &buffer) const = 0;
+
+        /// \brief Read the state from `buffer` at `position` and return the position after it
+        virtual std::size_t unpack(const std::vector<char> &buffer, std::size_t position) = 0;
+
+        void mpi_send_state(int rank_destination) const {
+            std::vector<char> buffer;
+            pack(buffer);
+            MPI_Send(buffer.data(), static_cast<int>(buffer.size()), MPI_BYTE, rank_destination, 0, MPI_COMM_WORLD);
+        }
+
+        void mpi_receive_state(int rank_source) {
+            MPI_Status status;
+            MPI_Probe(rank_source, 0, MPI_COMM_WORLD, &status);
+            int size;
+            MPI_Get_count(&status, MPI_BYTE, &size);
+            std::vector<char> buffer(static_cast<unsigned long>(size));
+            MPI_Recv(buffer.data(), size, MPI_BYTE, rank_source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            unpack(buffer, 0);
+        }
+
+      protected:
+        template <class T>
+        static void pack_value(std::vector<char> &buffer, const T &value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::size_t position = buffer.size();
+            buffer.resize(position + sizeof(T));
+            std::memcpy(buffer.data() + position, &value, sizeof(T));
+        }
+
+        template <class T>
+        static std::size_t unpack_value(const std::vector<char> &buffer, std::size_t position, T &value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::memcpy(&value, buffer.data() + position, sizeof(T));
+            return position + sizeof(T);
+        }
+
+        // The values are preceded by their number
+        template <class T>
+        static void pack_values(std::vector<char> &buffer, const std::vector<T> &values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            pack_value(buffer, static_cast<std::uint64_t>(values.size()));
+            std::size_t position = buffer.size();
+            buffer.resize(position + values.size() * sizeof(T));
+            std::memcpy(buffer.data() + position, values.data(), values.size() * sizeof(T));
+        }
+
+        template <class T>
+        static std::size_t unpack_values(const std::vector<char> &buffer, std::size_t position,
+                                         std::vector<T> &values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            std::uint64_t size;
+            position = unpack_value(buffer, position, size);
+            values.resize(size);
+            std::memcpy(values.data(), buffer.data() + position, values.size() * sizeof(T));
+            return position + values.size() * sizeof(T);
+        }
     };
 } // namespace particle_filter
 
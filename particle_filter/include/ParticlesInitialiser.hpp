@@ -13,6 +13,10 @@
 #include <vector>
 
 namespace particle_filter {
+    /// \brief Creates the particles of a particle filter
+    ///
+    /// Implementations choose how the particles are copied, e.g. a full copy
+    /// of a model or a copy of only the state the filter steps and reads.
     template <class ParticleType>
     class ParticlesInitialiser {
       private:
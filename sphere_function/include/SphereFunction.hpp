@@ -9,9 +9,11 @@
 #ifndef STATIONSIM_SphereFunction_HPP
 #define STATIONSIM_SphereFunction_HPP
 
+#include "CounterRandomEngine.hpp"
 #include "Particle.hpp"
 #include "SphereFunctionState.hpp"
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <vector>
@@ -23,17 +25,21 @@ namespace station_sim {
         float x;
         float y;
 
-        std::shared_ptr<std::mt19937> random_number_generator;
+        // The perturbations are drawn from counter-based engines keyed by the
+        // seed and the number of perturbations so far
+        std::uint32_t random_seed;
+        int perturbations_number;
 
       public:
         SphereFunction();
         SphereFunction(float x, float y);
+        SphereFunction(float x, float y, std::uint32_t random_seed);
         SphereFunction(const SphereFunction &sphere_function);
         ~SphereFunction() override;
 
         void reseed_random_number_generator();
 
-        [[nodiscard]] const SphereFunctionState get_state() const override;
+        [[nodiscard]] SphereFunctionState get_state() const override;
         void set_state(const SphereFunctionState &new_state);
         void perturb_state(float standard_deviation) override;
 
@@ -13,6 +13,7 @@
 #include "array"
 #include "mpi.h"
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
 using namespace particle_filter;
@@ -26,14 +27,14 @@ namespace station_sim {
         SphereFunctionState() = default;
         ~SphereFunctionState() override = default;
 
-        void mpi_send_state(int rank_destination) override {
-            MPI_Send(&x, 1, MPI_FLOAT, rank_destination, 0, MPI_COMM_WORLD);
-            MPI_Send(&y, 1, MPI_FLOAT, rank_destination, 0, MPI_COMM_WORLD);
+        void pack(std::vector<char> &buffer) const override {
+            pack_value(buffer, x);
+            pack_value(buffer, y);
         }
 
-        void mpi_receive_state(int rank_source) override {
-            MPI_Recv(&x, 1, MPI_FLOAT, rank_source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            MPI_Recv(&y, 1, MPI_FLOAT, rank_source, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        std::size_t unpack(const std::vector<char> &buffer, std::size_t position) override {
+            position = unpack_value(buffer, position, x);
+            return unpack_value(buffer, position, y);
         }
     };
 } // namespace station_sim
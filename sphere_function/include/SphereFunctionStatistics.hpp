@@ -31,7 +31,7 @@ namespace station_sim {
 
             std::vector<SphereFunctionState> particles_states;
             for (const auto &particle : particles) {
-                particles_states.push_back(particle.get_state());
+                particles_states.push_back(particle.get_state_view());
             }
 
             std::vector<float> distance;
@@ -10,38 +10,27 @@
 #include <algorithm>
 
 namespace station_sim {
-    SphereFunction::SphereFunction() {
-        reseed_random_number_generator();
-
-        this->x = 0;
-        this->y = 0;
-    }
+    SphereFunction::SphereFunction() : SphereFunction(0, 0) {}
 
     SphereFunction::~SphereFunction() = default;
 
-    SphereFunction::SphereFunction(float x, float y) {
-        reseed_random_number_generator();
+    SphereFunction::SphereFunction(float x, float y) : SphereFunction(x, y, CounterRandomEngine::random_seed()) {}
 
+    SphereFunction::SphereFunction(float x, float y, std::uint32_t random_seed) {
         this->x = x;
         this->y = y;
+        this->random_seed = random_seed;
+        this->perturbations_number = 0;
     }
 
-    SphereFunction::SphereFunction(const SphereFunction &sphere_function) {
-        reseed_random_number_generator();
-
-        this->x = sphere_function.x;
-        this->y = sphere_function.y;
-    }
+    SphereFunction::SphereFunction(const SphereFunction &sphere_function) = default;
 
     void SphereFunction::reseed_random_number_generator() {
-        std::random_device rd;
-        std::array<int, std::mt19937::state_size> seed_data;
-        std::generate_n(seed_data.data(), seed_data.size(), std::ref(rd));
-        std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-        random_number_generator = std::make_shared<std::mt19937>(std::mt19937(seq));
+        random_seed = CounterRandomEngine::random_seed();
+        perturbations_number = 0;
     }
 
-    const SphereFunctionState SphereFunction::get_state() const {
+    SphereFunctionState SphereFunction::get_state() const {
         SphereFunctionState sphere_function_state;
 
         sphere_function_state.x = x;
@@ -56,10 +45,12 @@ namespace station_sim {
     }
 
     void SphereFunction::perturb_state(float standard_deviation) {
+        CounterRandomEngine random_engine(random_seed, 0, static_cast<std::uint32_t>(perturbations_number));
+        perturbations_number++;
         std::normal_distribution<float> dis(0.0, standard_deviation);
 
-        this->x += dis(*random_number_generator);
-        this->y += dis(*random_number_generator);
+        this->x += dis(random_engine);
+        this->y += dis(random_engine);
     }
 
     bool SphereFunction::is_active() const { return true; }
@@ -9,6 +9,8 @@
 #ifndef STATIONSIM_AGENT_HPP
 #define STATIONSIM_AGENT_HPP
 
+#include "AgentStore.hpp"
+#include "CounterRandomEngine.hpp"
 #include "ModelParameters.hpp"
 #include "Point2D.hpp"
 #include <array>
@@ -17,83 +19,99 @@
 #include <vector>
 
 namespace station_sim {
+    using particle_filter::CounterRandomEngine;
+
     class Model;
-    enum class AgentStatus : int { not_started = 0, active = 1, finished = 2 };
+    class SpeedSolver;
 
-    class Agent {
-      public:
-        void set_random_number_generator(const std::shared_ptr<std::mt19937> &random_number_generator);
-        const Point2D &get_desired_location() const;
-        void set_desired_location(const Point2D &desired_location);
+    // Location and speed chosen by an agent for its next move
+    struct AgentMove {
+        Point2D location;
+        float speed = 0;
+        bool wiggle = false;
+    };
 
-      private:
-        std::shared_ptr<std::mt19937> random_number_generator;
-        std::uniform_real_distribution<float> float_distribution;
-        std::uniform_int_distribution<int> gates_in_int_distribution;
-        std::uniform_int_distribution<int> gates_out_int_distribution;
-        std::exponential_distribution<float> gates_speed_exponential_distribution;
-        std::normal_distribution<float> speed_normal_distribution;
-        std::uniform_int_distribution<int> wiggle_int_distribution;
+    // Locations of the collisions and wiggles of the agents moved in a step,
+    // one buffer per thread when the agents are moved in parallel
+    struct AgentMoveHistory {
+        std::vector<Point2D> collision_locations;
+        std::vector<Point2D> wiggle_locations;
+    };
 
+    // Handle to the data of an agent kept in the `AgentStore` of its model.
+    // The id of the agent never changes, its slot in the store changes when
+    // the model sorts the store.
+    class Agent {
+      private:
+        AgentStore *agent_store;
         int agent_id;
-        int steps_activate;
-        float wiggle;
-        float agent_max_speed;
-        std::vector<float> agent_available_speeds;
-        float agent_speed;
-        std::vector<Point2D> history_locations;
-
-        std::vector<float> history_speeds;
-        int history_wiggles = 0;
-        int history_collisions = 0;
-        int step_start{};
-        AgentStatus status;
+        int store_slot;
 
-        int steps_taken;
-        int gate_in;
-        Point2D start_location;
-        int gate_out;
-        Point2D desired_location;
-        Point2D agent_location;
-        float steps_delay;
+        // Number of speeds left to test above which `move_agent` uses the
+        // speed solver instead of testing each of them
+        static constexpr std::vector<float>::size_type min_solver_speeds = 2;
 
       public:
         Agent() = delete;
-        Agent(int unique_id, const Model &model, const ModelParameters &model_parameters,
-              std::shared_ptr<std::mt19937> generator);
-        Agent(int unique_id, const Point2D location, const Model &model,
-              const ModelParameters &model_parameters, std::shared_ptr<std::mt19937> generator);
-        Agent(const Agent &agent);
+        Agent(int unique_id, AgentStore &agent_store);
+        Agent(int unique_id, AgentStore &agent_store, const Model &model, const ModelParameters &model_parameters);
+        Agent(int unique_id, const Point2D location, AgentStore &agent_store, const Model &model,
+              const ModelParameters &model_parameters);
+        Agent(const Agent &agent) = default;
+        Agent &operator=(const Agent &agent) = default;
         ~Agent() = default;
 
+        void set_agent_store(AgentStore &agent_store);
+        void set_store_slot(int slot);
+        [[nodiscard]] int get_store_slot() const;
+
+        // The step kernels are instantiated for every `StepPolicy`
+        template <class StepPolicy>
         void step(Model &model, const ModelParameters &model_parameters);
+
+        // Steps of the synchronous update of `Model`, where the moves of all
+        // the agents are proposed from the same locations before committing
+        // them.
+        void activate_agent(Model &model);
+        template <class StepPolicy>
+        [[nodiscard]] AgentMove propose_move(const Model &model, SpeedSolver &speed_solver,
+                                             AgentMoveHistory &move_history);
+        template <class StepPolicy>
+        void deactivate_agent_if_reached_exit_gate(Model &model, const ModelParameters &model_parameters);
+
         [[nodiscard]] const Point2D &get_agent_location() const;
         [[nodiscard]] float get_agent_speed() const;
-        [[nodiscard]] const std::vector<Point2D> &get_history_locations() const;
         [[nodiscard]] int get_history_wiggles() const;
         [[nodiscard]] int get_history_collisions() const;
         [[nodiscard]] AgentStatus getStatus() const;
         void set_status(AgentStatus status);
         [[nodiscard]] int get_agent_id() const;
         void set_agent_location(const Point2D &agent_location);
-        [[nodiscard]] static bool is_outside_boundaries(std::vector<Point2D> boundary_vertices, const Point2D &location);
-
+        [[nodiscard]] const Point2D &get_desired_location() const;
+        void set_desired_location(const Point2D &desired_location);
+        [[nodiscard]] static bool is_outside_boundaries(const std::vector<Point2D> &boundary_vertices,
+                                                        const Point2D &location);
 
       private:
-        void initialize_start_location(const Model &model, const ModelParameters &model_parameters);
-        void initialize_desired_location(const Model &model, const ModelParameters &model_parameters);
-        void initialize_speed(const Model &model, const ModelParameters &model_parameters);
-        void activate_agent(Model &model);
-        void deactivate_agent_if_reached_exit_gate(Model &model, const ModelParameters &model_parameters);
-        [[nodiscard]] Point2D calculate_agent_direction();
-        [[nodiscard]] bool collides_other_agent(const Model &model, const ModelParameters &model_parameters,
-                                                const Point2D &location) const;
-        static void clip_vector_values_to_boundaries(Point2D &location, std::vector<Point2D> boundary_vertices);
-        void initialize_random_distributions(const ModelParameters &model_parameters);
-
-        void move_agent(Model &model, const ModelParameters &model_parameters);
+        void initialize_start_location(const Model &model, const ModelParameters &model_parameters,
+                                       CounterRandomEngine &random_engine);
+        void initialize_desired_location(const Model &model, CounterRandomEngine &random_engine);
+        void initialize_speed(const Model &model, const ModelParameters &model_parameters,
+                              CounterRandomEngine &random_engine);
+        void initialize_activation(const ModelParameters &model_parameters, CounterRandomEngine &random_engine);
+        [[nodiscard]] Point2D calculate_agent_direction() const;
+        [[nodiscard]] Point2D calculate_agent_step_direction(const Model &model) const;
+        template <class StepPolicy>
+        [[nodiscard]] bool collides_other_agent(const Model &model, const Point2D &location) const;
 
-        void add_agent_location_history();
+        template <class StepPolicy>
+        void move_agent(Model &model);
+        template <class StepPolicy>
+        [[nodiscard]] AgentMove find_move(const Model &model, SpeedSolver &speed_solver,
+                                          AgentMoveHistory &move_history);
+        template <class StepPolicy>
+        void finish_move(const Model &model, AgentMove &move, AgentMoveHistory &move_history);
+        [[nodiscard]] AgentMove find_free_flow_move(const Model &model) const;
     };
 } // namespace station_sim
 #endif // STATIONSIM_AGENT_HPP
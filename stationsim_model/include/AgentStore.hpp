@@ -0,0 +1,114 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_AGENTSTORE_HPP
+#define STATIONSIM_AGENTSTORE_HPP
+
+#include "ModelParameters.hpp"
+#include "Point2D.hpp"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace station_sim {
+    enum class AgentStatus : int { not_started = 0, active = 1, finished = 2 };
+
+    // Data of an agent which is not needed to move it
+    struct AgentColdData {
+        int gate_in = 0;
+        int gate_out = 0;
+        Point2D start_location;
+        int steps_activate = 0;
+        // In time units
+        float step_start = 0;
+        float steps_taken = 0;
+        float steps_delay = 0;
+        std::vector<float> available_speeds;
+    };
+
+    // The locations of the agents are recorded by the `TrajectoryRecorder` of
+    // the model
+    struct AgentHistory {
+        std::vector<float> speeds;
+        int wiggles = 0;
+        int collisions = 0;
+    };
+
+    // Storage of the agents of a model as a structure of arrays. The fields
+    // read on every step by the collision scan and the state functions are
+    // kept in contiguous arrays indexed by the slot of the agent, everything
+    // else lives in side tables. `Agent` objects are handles to an entry of
+    // the store.
+    //
+    // The slots start in agent id order. `sort_by_location` moves the agents
+    // along a Z-order (Morton) curve of their locations, so that agents close
+    // to each other in the station are close to each other in memory; `ids`
+    // and `slots` map between the two orders.
+    class AgentStore {
+      public:
+        std::vector<int> ids;
+        std::vector<int> slots;
+
+        std::vector<Point2D> locations;
+        std::vector<Point2D> desired_locations;
+        std::vector<AgentStatus> statuses;
+        std::vector<float> speeds;
+        std::vector<float> max_speeds;
+        std::vector<float> wiggles;
+
+        std::vector<AgentColdData> cold_data;
+        std::vector<AgentHistory> histories;
+
+        std::uniform_real_distribution<float> float_distribution;
+        std::uniform_int_distribution<int> gates_in_int_distribution;
+        std::uniform_int_distribution<int> gates_out_int_distribution;
+        std::exponential_distribution<float> gates_speed_exponential_distribution;
+        std::normal_distribution<float> speed_normal_distribution;
+        std::uniform_int_distribution<int> wiggle_int_distribution;
+
+        AgentStore() = default;
+        ~AgentStore() = default;
+
+        void resize(unsigned long size);
+        // Resize to `size` agents which have not started, in id order, with
+        // empty histories. The arrays keep their capacity.
+        void reset(unsigned long size);
+        void assign_without_histories(const AgentStore &agent_store);
+        [[nodiscard]] unsigned long size() const;
+        void initialize_random_distributions(const ModelParameters &model_parameters);
+
+        // Sort the active agents first, then the others, each along the
+        // Morton curve of a grid of `cell_size`. Returns false if the order
+        // has not changed.
+        bool sort_by_location(float cell_size);
+
+        // Copy of `field`, indexed by slot, in agent id order
+        template <class T>
+        [[nodiscard]] std::vector<T> by_id(const std::vector<T> &field) const {
+            std::vector<T> values;
+            by_id(field, values);
+            return values;
+        }
+
+        // Same, into `values`, which keeps its capacity
+        template <class T>
+        void by_id(const std::vector<T> &field, std::vector<T> &values) const {
+            values.resize(slots.size());
+            for (unsigned long i = 0; i < slots.size(); i++) {
+                values[i] = field[static_cast<unsigned long>(slots[i])];
+            }
+        }
+
+      private:
+        [[nodiscard]] static std::uint32_t morton_code(std::uint32_t x, std::uint32_t y);
+        template <class T>
+        static void permute(std::vector<T> &field, const std::vector<int> &order);
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_AGENTSTORE_HPP
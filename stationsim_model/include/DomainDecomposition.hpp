@@ -0,0 +1,98 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_DOMAINDECOMPOSITION_HPP
+#define STATIONSIM_DOMAINDECOMPOSITION_HPP
+
+#include "AgentStore.hpp"
+#include "Point2D.hpp"
+#include "mpi.h"
+#include <vector>
+
+namespace station_sim {
+    // Partition of the station of a model in vertical strips of equal width,
+    // one per rank of a communicator. Each active agent is owned, and moved,
+    // by the rank of the strip it is in. Every rank keeps the whole agent
+    // store, but only the owned agents and the agents of the other strips
+    // within `halo_width` of its own (the halo) are up to date; the locations
+    // of the other active agents are NaN, so they are never found by the
+    // neighbour search.
+    class DomainDecomposition {
+      private:
+        // Data of an agent sent to another rank
+        struct AgentRecord {
+            int agent_id;
+            AgentStatus status;
+            Point2D location;
+            float speed;
+        };
+
+        MPI_Comm communicator = MPI_COMM_WORLD;
+        int rank = 0;
+        int ranks_number = 1;
+
+        // Strip `r` starts at `strip_starts[r]`, the first and last strips
+        // are open to the left and right
+        std::vector<float> strip_starts;
+        float halo_width = 0;
+
+        // By agent id
+        std::vector<char> owned;
+
+        // Records to send, by destination rank, and received
+        std::vector<std::vector<AgentRecord>> outgoing_records;
+        std::vector<AgentRecord> send_records;
+        std::vector<AgentRecord> received_records;
+        mutable std::vector<int> rank_sizes;
+
+      public:
+        DomainDecomposition() = default;
+        DomainDecomposition(MPI_Comm communicator, const std::vector<Point2D> &boundary_vertices, float halo_width,
+                            unsigned long agents_number);
+
+        [[nodiscard]] int get_rank() const;
+        [[nodiscard]] int get_ranks_number() const;
+        [[nodiscard]] float get_halo_width() const;
+        [[nodiscard]] int strip_of(float x) const;
+        [[nodiscard]] bool owns(int agent_id) const;
+
+        // Take the agents in `agent_ids` which are in the strip of the rank,
+        // and give up the others
+        void claim(const AgentStore &agent_store, const std::vector<int> &agent_ids);
+
+        // Send the owned agents near the other strips to their ranks, and
+        // fill `local_agents` with the owned and halo agents, by id
+        void exchange_halo(AgentStore &agent_store, const std::vector<int> &active_agents,
+                           std::vector<int> &local_agents);
+
+        // Hand the agents of `moved_agents` which left the strip to their new
+        // rank, and tell all the ranks about the agents which finished. The
+        // agents which finished on the other ranks are marked as finished in
+        // the store and listed in `remote_finished_agents`.
+        void migrate(AgentStore &agent_store, const std::vector<int> &moved_agents,
+                     std::vector<int> &remote_finished_agents);
+
+        // Locations of all the agents, by id, with the active ones gathered
+        // from their owners
+        void gather_locations(const AgentStore &agent_store, const std::vector<int> &active_agents,
+                              std::vector<Point2D> &locations) const;
+
+        // Concatenation, by rank, of the `points` of all the ranks
+        [[nodiscard]] std::vector<Point2D> gather_points(const std::vector<Point2D> &points) const;
+
+      private:
+        // Send the outgoing records to their ranks and receive the records of
+        // the other ranks
+        void exchange_records();
+        void all_gather_records(const std::vector<AgentRecord> &records);
+        template <class T>
+        [[nodiscard]] std::vector<T> all_gather(const std::vector<T> &values) const;
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_DOMAINDECOMPOSITION_HPP
@@ -10,11 +10,20 @@
 #define STATIONSIM_MODEL_HPP
 
 #include "Agent.hpp"
+#include "AgentStore.hpp"
+#include "CounterRandomEngine.hpp"
+#include "DomainDecomposition.hpp"
 #include "H5Cpp.h"
 #include "ModelState.hpp"
+#include "ModelStateView.hpp"
+#include "NeighbourSearch.hpp"
 #include "Particle.hpp"
 #include "Point2D.hpp"
+#include "Scenario.hpp"
+#include "SpeedSolver.hpp"
+#include "TrajectoryRecorder.hpp"
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <vector>
@@ -23,60 +32,156 @@ namespace station_sim {
     class ModelParameters;
     enum class ModelStatus : int { not_started = 0, active = 1, finished = 2 };
 
+    // Streams of the random numbers of a model, so that the numbers drawn
+    // for different purposes are independent
+    enum class RandomStream : std::uint32_t { agent_initialisation = 0, agent_move = 1, state_perturbation = 2 };
+
     class Model : public Particle<ModelState> {
+      public:
+        using StateViewType = ModelStateView;
+
       private:
         int model_id;
         ModelStatus status;
-        float speed_step;
 
         // History related variables
         int history_collisions_number;
         std::vector<Point2D> history_collision_locations;
         int wiggle_collisions_number;
         std::vector<Point2D> history_wiggle_locations;
-        std::shared_ptr<std::mt19937> random_number_generator;
-        ModelParameters model_parameters;
+
+        // Shared by all the copies of the model. What the model records and
+        // prints is its own choice, so a particle can switch it off.
+        std::shared_ptr<const Scenario> scenario;
+        bool do_history = false;
+        bool do_print = false;
+
+        // The random numbers are drawn from counter-based engines keyed by
+        // the seed, the model id and the purpose of the numbers
+        std::uint32_t random_seed = 0;
+        int perturbations_number = 0;
+
+        // Time at the start of the step, in time units, and length of the
+        // step
+        double time = 0;
+        float time_step = 1;
 
         int print_per_steps;
-        std::vector<std::vector<Point2D>> history_state;
+        TrajectoryRecorder trajectory_recorder;
+
+        AgentStore agent_store;
+        std::unique_ptr<NeighbourSearch> neighbour_search;
+
+        // Strips of the station moved by the ranks, if the model is
+        // distributed
+        std::unique_ptr<DomainDecomposition> domain_decomposition;
+        std::vector<int> owned_agents;
+        std::vector<int> local_agents;
+        std::vector<int> local_slots;
+        std::vector<int> remote_finished_agents;
+
+        // Work buffers of the agent moves, one per thread
+        std::vector<SpeedSolver> speed_solvers;
+        std::vector<AgentMoveHistory> move_histories;
+        std::vector<std::vector<int>> conflict_candidates;
+
+        // Instantiation of `step_with_policy` matching the parameters, which
+        // runs a number of steps
+        using StepKernel = void (Model::*)(int);
+        StepKernel step_kernel = nullptr;
+
+        // Agents which have not started, by activation step, and the active
+        // agents, by id. Only the active agents are moved and indexed.
+        std::vector<int> activation_queue;
+        unsigned long activation_queue_position = 0;
+        std::vector<int> active_agents;
+        std::vector<int> active_slots;
+
+        // Agents which cannot meet another agent or an edge of the station
+        // for a few steps are moved without the collision and boundary tests
+        // while `step_id < free_flow_until[agent_id]`. An agent which cannot
+        // is tested again at `free_flow_next_test[agent_id]`.
+        std::vector<int> free_flow_until;
+        std::vector<int> free_flow_next_test;
+        std::vector<int> free_flow_candidates;
+        std::vector<int> time_step_candidates;
+
+        // Locations of the agents recorded in the trajectory, by id
+        std::vector<Point2D> recorded_locations;
+
+        // Work buffers of the synchronous update
+        std::vector<AgentMove> proposed_moves;
+        std::vector<Point2D> previous_locations;
+        std::vector<char> conflicting_moves;
 
       public:
         int step_id = 0;
         int pop_active = 0;
         int pop_finished = 0;
-        std::vector<Point2D> boundary_vertices;
-        std::vector<Gate> gates_in;
-        std::vector<Gate> gates_out;
         std::vector<Agent> agents;
-        [[nodiscard]] std::shared_ptr<std::mt19937> get_generator() const;
         std::vector<float> steps_expected;
         std::vector<float> steps_taken;
         std::vector<float> steps_delay;
 
         Model() = default;
-        Model(int unique_id, ModelParameters model_parameters);
+        Model(int unique_id, const ModelParameters &model_parameters);
+        Model(int unique_id, std::shared_ptr<const Scenario> scenario);
         Model(const Model &model);
+        Model &operator=(const Model &model);
         ~Model() override;
 
+        [[nodiscard]] Model clone_particle() const;
+
+        // Start the model again, as a model built with the same parameters
+        // and `random_seed`, or with `model_parameters`. The agents are
+        // initialised again in place, so the allocations of the model are
+        // reused unless the population grows. A distributed model is no
+        // longer distributed.
+        void reset(std::uint32_t random_seed);
+        void reset(const ModelParameters &model_parameters);
+
         [[nodiscard]] int get_unique_id() const;
+        [[nodiscard]] const Scenario &get_scenario() const;
+        [[nodiscard]] const std::vector<Point2D> &get_boundary_vertices() const;
+        [[nodiscard]] const StationGeometry &get_station_geometry() const;
         [[nodiscard]] const std::vector<Gate> &get_gates_in() const;
         [[nodiscard]] const std::vector<Gate> &get_gates_out() const;
         void step();
+        void advance(int steps) override;
         [[nodiscard]] int get_history_collisions_number() const;
         void set_history_collisions_number(int history_collisions_number);
         void increase_history_collisions_number_by_value(int value_increase);
         void add_to_history_collision_locations(Point2D new_location);
         void increase_wiggle_collisions_number_by_value(int value_increase);
         void add_to_history_wiggle_locations(Point2D new_location);
+        [[nodiscard]] const AgentStore &get_agent_store() const;
+        [[nodiscard]] const TrajectoryRecorder &get_trajectory_recorder() const;
+        [[nodiscard]] const std::vector<int> &get_active_agents() const;
+        [[nodiscard]] bool is_free_flowing(int agent_id) const;
+        void distribute(MPI_Comm communicator);
+        [[nodiscard]] const DomainDecomposition *get_domain_decomposition() const;
+        [[nodiscard]] const NeighbourSearch &get_neighbour_search() const;
+        void update_agent_location_in_neighbour_search(int agent_id, const Point2D &old_location,
+                                                       const Point2D &new_location);
+        [[nodiscard]] SpeedSolver &get_speed_solver(int thread);
+        [[nodiscard]] AgentMoveHistory &get_move_history(int thread);
         [[nodiscard]] float get_speed_step() const;
+        [[nodiscard]] double get_time() const;
+        [[nodiscard]] float get_time_step() const;
+        [[nodiscard]] CounterRandomEngine get_random_engine(RandomStream stream, int agent_id) const;
+        [[nodiscard]] int draw_wiggle_direction(int agent_id) const;
         void calculate_print_model_run_analytics();
-        [[nodiscard]] ModelParameters get_model_parameters() const;
+        [[nodiscard]] const ModelParameters &get_model_parameters() const;
+        [[nodiscard]] bool is_do_history() const;
         [[nodiscard]] bool model_simulation_finished();
         void write_model_output_to_hdf_5(std::string file_name);
         [[nodiscard]] ModelStatus get_status() const;
+        [[nodiscard]] std::uint32_t get_random_seed() const;
         void reseed_random_number_generator();
-        [[nodiscard]] std::vector<Point2D> get_agents_location();
-        [[nodiscard]] const ModelState get_state() const override;
+        [[nodiscard]] std::vector<Point2D> get_agents_location() const;
+        void get_agents_location(std::vector<Point2D> &locations) const;
+        [[nodiscard]] ModelState get_state() const override;
+        [[nodiscard]] ModelStateView get_state_view() const;
         void set_state(const ModelState &new_state);
         [[nodiscard]] std::vector<float> get_active_agents_state() const;
         [[nodiscard]] bool is_active() const override;
@@ -84,19 +189,47 @@ namespace station_sim {
 
       private:
         void initialize_model(int unique_id);
-        void set_boundaries();
-        void set_gates_in(std::vector<Gate> gates);
-        void set_gates_out(std::vector<Gate> gates);
+        void create_neighbour_search();
+        void copy_simulation_state(const Model &model);
         void generate_agents();
+        void initialize_agent_schedule();
+        void activate_due_agents();
+        void remove_finished_agents();
+        void update_active_slots();
+        void find_free_flow_agents();
+        [[nodiscard]] bool can_free_flow(int agent_id, int steps, float max_speed);
+        void reset_free_flow();
+        [[nodiscard]] float choose_time_step();
+        void sort_agents();
+        template <bool DoHistory, bool DoPrint>
+        [[nodiscard]] StepKernel select_step_kernel() const;
+        void select_step_kernel();
+        template <class StepPolicy>
+        void step_with_policy(int steps);
+        template <class StepPolicy>
         void move_agents();
+        template <class StepPolicy>
+        void move_agents_synchronously();
+        template <class StepPolicy>
+        void move_agents_distributed();
+        void index_local_agents();
+        template <class StepPolicy>
+        void propose_moves(const std::vector<int> &agent_ids);
+        void commit_moves(const std::vector<int> &agent_ids);
+        template <class StepPolicy>
+        void resolve_move_conflicts(const std::vector<int> &agent_ids);
+        template <class StepPolicy>
+        [[nodiscard]] bool has_move_conflict(int agent_id, std::vector<int> &candidates) const;
+        void resize_thread_buffers();
+        void flush_move_histories();
 
         void write_agent_locations_to_hdf_5(H5::Group &history_group);
 
         void write_model_parameters_to_hdf5(H5::Group &model_parameters_group);
 
-        void write_collisions_history_to_hdf_5(H5::Group &history_group);
+        void write_collisions_history_to_hdf_5(H5::Group &history_group, const std::vector<Point2D> &locations);
 
-        void write_wiggle_history_to_hdf_5(H5::Group &history_group);
+        void write_wiggle_history_to_hdf_5(H5::Group &history_group, const std::vector<Point2D> &locations);
     };
 } // namespace station_sim
 
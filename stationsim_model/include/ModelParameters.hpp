@@ -11,15 +11,23 @@
 
 #include "Point2D.hpp"
 #include "Gate.hpp"
+#include "NeighbourSearch.hpp"
 #include <vector>
 
 namespace station_sim {
+    // How the agents are moved in a step: one after another, each agent seeing
+    // the agents already moved, or all from the same locations, which can be
+    // done in parallel
+    enum class AgentUpdateMode : int { sequential = 0, synchronous = 1 };
+
     class ModelParameters {
       private:
         int population_total;
         std::vector<Point2D> agents_locations;
 
         std::vector<Point2D> boundary_vertices;
+        std::vector<std::vector<Point2D>> obstacles;
+        float raster_cell_size;
 
         std::vector<Gate> gates_in;
         std::vector<Gate> gates_out;
@@ -35,10 +43,20 @@ namespace station_sim {
 
         float separation;
         float max_wiggle;
+        NeighbourSearchType neighbour_search_type;
+        float verlet_skin;
+        int reorder_period;
+        int free_flow_steps;
+        AgentUpdateMode agent_update_mode;
 
         int step_limit;
+        float time_step;
+        bool adaptive_time_step;
+        float min_time_step;
 
         bool do_history;
+        int history_stride;
+        unsigned long history_memory_limit;
         bool do_print;
 
         int random_seed;
@@ -50,14 +68,18 @@ namespace station_sim {
 
         [[nodiscard]] int get_population_total() const;
         void set_population_total(int value);
-        [[nodiscard]] std::vector<Point2D> get_agents_locations() const;
+        [[nodiscard]] const std::vector<Point2D> &get_agents_locations() const;
         void set_agents_locations(std::vector<Point2D> locations);
-        [[nodiscard]] std::vector<Point2D> get_boundaries() const;
+        [[nodiscard]] const std::vector<Point2D> &get_boundaries() const;
         void set_boundaries(std::vector<Point2D> boundary_vertices);
-        [[nodiscard]] std::vector<Gate> get_gates_in() const;
+        [[nodiscard]] const std::vector<std::vector<Point2D>> &get_obstacles() const;
+        void set_obstacles(std::vector<std::vector<Point2D>> obstacles);
+        [[nodiscard]] float get_raster_cell_size() const;
+        void set_raster_cell_size(float value);
+        [[nodiscard]] const std::vector<Gate> &get_gates_in() const;
         [[nodiscard]] int get_gates_in_count() const;
         void set_gates_in(std::vector<Gate> gates);
-        [[nodiscard]] std::vector<Gate> get_gates_out() const;
+        [[nodiscard]] const std::vector<Gate> &get_gates_out() const;
         [[nodiscard]] int get_gates_out_count() const;
         void set_gates_out(std::vector<Gate> gates);
         [[nodiscard]] float get_gates_space() const;
@@ -76,10 +98,30 @@ namespace station_sim {
         void set_separation(float value);
         [[nodiscard]] float get_max_wiggle() const;
         void set_max_wiggle(float value);
+        [[nodiscard]] NeighbourSearchType get_neighbour_search_type() const;
+        void set_neighbour_search_type(NeighbourSearchType value);
+        [[nodiscard]] float get_verlet_skin() const;
+        void set_verlet_skin(float value);
+        [[nodiscard]] int get_reorder_period() const;
+        void set_reorder_period(int value);
+        [[nodiscard]] int get_free_flow_steps() const;
+        void set_free_flow_steps(int value);
+        [[nodiscard]] AgentUpdateMode get_agent_update_mode() const;
+        void set_agent_update_mode(AgentUpdateMode value);
         [[nodiscard]] int get_step_limit() const;
         void set_step_limit(int value);
+        [[nodiscard]] float get_time_step() const;
+        void set_time_step(float value);
+        [[nodiscard]] bool is_adaptive_time_step() const;
+        void set_adaptive_time_step(bool value);
+        [[nodiscard]] float get_min_time_step() const;
+        void set_min_time_step(float value);
         [[nodiscard]] bool is_do_history() const;
         void set_do_history(bool value);
+        [[nodiscard]] int get_history_stride() const;
+        void set_history_stride(int value);
+        [[nodiscard]] unsigned long get_history_memory_limit() const;
+        void set_history_memory_limit(unsigned long value);
         [[nodiscard]] bool is_do_print() const;
         void set_do_print(bool value);
         [[nodiscard]] int get_random_seed() const;
@@ -15,6 +15,7 @@
 #include "array"
 #include "mpi.h"
 #include <algorithm>
+#include <cstddef>
 #include <vector>
 
 using namespace particle_filter;
@@ -29,70 +30,16 @@ namespace station_sim {
         ModelState() = default;
         ~ModelState() override = default;
 
-        void mpi_send_state(int rank_destination) override {
-            // send agents' locations
-            std::vector<float> x(agents_location.size());
-            std::vector<float> y(agents_location.size());
-
-            for (unsigned long i = 0; i < agents_location.size(); i++) {
-                x.at(i) = agents_location.at(i).x;
-                y.at(i) = agents_location.at(i).y;
-            }
-
-            MPI_Send(x.data(), static_cast<int>(x.size()), MPI_FLOAT, rank_destination, 0, MPI_COMM_WORLD);
-            MPI_Send(y.data(), static_cast<int>(y.size()), MPI_FLOAT, rank_destination, 0, MPI_COMM_WORLD);
-
-            // send agents' status
-            std::vector<int> agent_status(agent_active_status.size());
-            for (unsigned long i = 0; i < agent_active_status.size(); i++) {
-                agent_status.at(i) = static_cast<int>(agent_active_status.at(i));
-            }
-            MPI_Send(agent_status.data(), static_cast<int>(agent_status.size()), MPI_INT, rank_destination, 0,
-                     MPI_COMM_WORLD);
-
-            // send agents' desired locations
-            for (unsigned long i = 0; i < agents_desired_location.size(); i++) {
-                x.at(i) = agents_desired_location.at(i).x;
-                y.at(i) = agents_desired_location.at(i).y;
-            }
-            MPI_Send(x.data(), static_cast<int>(x.size()), MPI_FLOAT, rank_destination, 0, MPI_COMM_WORLD);
-            MPI_Send(y.data(), static_cast<int>(y.size()), MPI_FLOAT, rank_destination, 0, MPI_COMM_WORLD);
+        void pack(std::vector<char> &buffer) const override {
+            pack_values(buffer, agents_location);
+            pack_values(buffer, agent_active_status);
+            pack_values(buffer, agents_desired_location);
         }
 
-        void mpi_receive_state(int rank_source) override {
-            // receive agent locations
-            std::vector<float> x(agents_location.size());
-            std::vector<float> y(agents_location.size());
-
-            MPI_Recv(x.data(), static_cast<int>(x.size()), MPI_FLOAT, rank_source, 0, MPI_COMM_WORLD,
-                     MPI_STATUS_IGNORE);
-            MPI_Recv(y.data(), static_cast<int>(y.size()), MPI_FLOAT, rank_source, 0, MPI_COMM_WORLD,
-                     MPI_STATUS_IGNORE);
-
-            for (unsigned long i = 0; i < agents_location.size(); i++) {
-                agents_location.at(i).x = x.at(i);
-                agents_location.at(i).y = y.at(i);
-            }
-
-            // receive agents' status
-            std::vector<int> agent_status(agent_active_status.size());
-            MPI_Recv(agent_status.data(), static_cast<int>(agent_status.size()), MPI_INT, rank_source, 0,
-                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-
-            for (unsigned long i = 0; i < agent_active_status.size(); i++) {
-                agent_active_status.at(i) = static_cast<AgentStatus>(agent_status.at(i));
-            }
-
-            // receive agents' desired locations
-            MPI_Recv(x.data(), static_cast<int>(x.size()), MPI_FLOAT, rank_source, 0, MPI_COMM_WORLD,
-                     MPI_STATUS_IGNORE);
-            MPI_Recv(y.data(), static_cast<int>(y.size()), MPI_FLOAT, rank_source, 0, MPI_COMM_WORLD,
-                     MPI_STATUS_IGNORE);
-
-            for (unsigned long i = 0; i < agents_desired_location.size(); i++) {
-                agents_desired_location.at(i).x = x.at(i);
-                agents_desired_location.at(i).y = y.at(i);
-            }
+        std::size_t unpack(const std::vector<char> &buffer, std::size_t position) override {
+            position = unpack_values(buffer, position, agents_location);
+            position = unpack_values(buffer, position, agent_active_status);
+            return unpack_values(buffer, position, agents_desired_location);
         }
     };
 } // namespace station_sim
@@ -0,0 +1,55 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_MODELSTATEVIEW_HPP
+#define STATIONSIM_MODELSTATEVIEW_HPP
+
+#include "AgentStore.hpp"
+#include "ModelState.hpp"
+#include "Point2D.hpp"
+
+namespace station_sim {
+    // Read-only view of the state of a model, by agent id, over the arrays
+    // of its agent store. Nothing is copied, so the view is only valid until
+    // the model is stepped, sorted, assigned or destroyed. `ModelState` is
+    // the copy of it sent between ranks.
+    //
+    // The view of a distributed model only shows the agents of its rank, the
+    // other active agents have NaN locations.
+    class ModelStateView {
+      private:
+        const AgentStore *agent_store;
+
+      public:
+        explicit ModelStateView(const AgentStore &agent_store) : agent_store(&agent_store) {}
+
+        [[nodiscard]] unsigned long size() const { return agent_store->slots.size(); }
+
+        [[nodiscard]] const Point2D &agent_location(unsigned long agent_id) const {
+            return agent_store->locations[static_cast<unsigned long>(agent_store->slots[agent_id])];
+        }
+
+        [[nodiscard]] AgentStatus agent_status(unsigned long agent_id) const {
+            return agent_store->statuses[static_cast<unsigned long>(agent_store->slots[agent_id])];
+        }
+
+        [[nodiscard]] const Point2D &agent_desired_location(unsigned long agent_id) const {
+            return agent_store->desired_locations[static_cast<unsigned long>(agent_store->slots[agent_id])];
+        }
+
+        [[nodiscard]] ModelState to_state() const {
+            ModelState model_state;
+            model_state.agents_location = agent_store->by_id(agent_store->locations);
+            model_state.agent_active_status = agent_store->by_id(agent_store->statuses);
+            model_state.agents_desired_location = agent_store->by_id(agent_store->desired_locations);
+            return model_state;
+        }
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_MODELSTATEVIEW_HPP
@@ -27,9 +27,10 @@ namespace station_sim {
 
             this->particle_filter_data_feed = particle_filter_data_feed;
 
-            std::vector<ModelState> particles_states;
+            std::vector<ModelStateView> particles_states;
+            particles_states.reserve(particles.size());
             for (const auto &particle : particles) {
-                particles_states.push_back(particle.get_state());
+                particles_states.push_back(particle.get_state_view());
             }
 
             std::vector<float> absolute_mean = calculate_absolute_average(particles_states);
@@ -46,7 +47,7 @@ namespace station_sim {
 
         // For each active agent state (i.e. x and y) calculate the absolute average from all particles
         [[nodiscard]] std::vector<float>
-        calculate_absolute_average(const std::vector<ModelState> &particles_states) override {
+        calculate_absolute_average(const std::vector<ModelStateView> &particles_states) override {
             ModelState data_feed_state = particle_filter_data_feed->get_state();
 
             // calculate the number of active agents in the data feed
@@ -58,13 +59,13 @@ namespace station_sim {
             std::vector<float> sum(static_cast<unsigned long>(number_of_active_agents_in_datafeed * 2));
             std::fill(sum.begin(), sum.end(), 0);
 
-            for (const ModelState &particle_state : particles_states) {
+            for (const ModelStateView &particle_state : particles_states) {
                 unsigned long active_agent_index = 0;
-                for (unsigned long j = 0; j < particle_state.agents_location.size(); j++) {
+                for (unsigned long j = 0; j < particle_state.size(); j++) {
                     if (data_feed_state.agent_active_status.at(j) == AgentStatus::active) {
-                        sum.at(active_agent_index) += particle_state.agents_location.at(j).x;
+                        sum.at(active_agent_index) += particle_state.agent_location(j).x;
                         active_agent_index++;
-                        sum.at(active_agent_index) += particle_state.agents_location.at(j).y;
+                        sum.at(active_agent_index) += particle_state.agent_location(j).y;
                         active_agent_index++;
                     }
                 }
@@ -98,7 +99,7 @@ namespace station_sim {
         }
 
         // For each active agent state (i.e. x and y) calculate the weighted average from all particles
-        [[nodiscard]] std::vector<float> calculate_weighted_average(const std::vector<ModelState> &particles_states,
+        [[nodiscard]] std::vector<float> calculate_weighted_average(const std::vector<ModelStateView> &particles_states,
                                                                     const std::vector<float> &weights) override {
             ModelState data_feed_state = particle_filter_data_feed->get_state();
 
@@ -114,11 +115,11 @@ namespace station_sim {
 
             for (unsigned long i = 0; i < particles_states.size(); i++) {
                 unsigned long active_agent_index = 0;
-                for (unsigned long j = 0; j < particles_states.at(i).agents_location.size(); j++) {
+                for (unsigned long j = 0; j < particles_states.at(i).size(); j++) {
                     if (data_feed_state.agent_active_status.at(j) == AgentStatus::active) {
-                        sum.at(active_agent_index) += particles_states.at(i).agents_location.at(j).x * weights.at(i);
+                        sum.at(active_agent_index) += particles_states.at(i).agent_location(j).x * weights.at(i);
                         active_agent_index++;
-                        sum.at(active_agent_index) += particles_states.at(i).agents_location.at(j).y * weights.at(i);
+                        sum.at(active_agent_index) += particles_states.at(i).agent_location(j).y * weights.at(i);
                         active_agent_index++;
                     }
                 }
@@ -0,0 +1,183 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_NEIGHBOURSEARCH_HPP
+#define STATIONSIM_NEIGHBOURSEARCH_HPP
+
+#include "Point2D.hpp"
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace station_sim {
+    class AgentStore;
+    enum class NeighbourSearchType : int { brute_force = 0, uniform_grid = 1, sorted_sweep = 2, verlet_list = 3 };
+
+    // Index over the locations of the agents of a model, used to answer the
+    // collision queries of `Agent::collides_other_agent`. The model rebuilds
+    // the index over its active agents at the start of every step and updates
+    // it every time an agent moves, so all the backends give the same answers
+    // as the brute-force scan. The agents are given by their slot in the
+    // `AgentStore`.
+    class NeighbourSearch {
+      protected:
+        float separation;
+
+      public:
+        explicit NeighbourSearch(float separation);
+        virtual ~NeighbourSearch() = default;
+
+        // `verlet_skin` is only used by the Verlet lists
+        [[nodiscard]] static std::unique_ptr<NeighbourSearch> create(NeighbourSearchType type, float separation,
+                                                                     float verlet_skin = 4);
+        [[nodiscard]] virtual std::unique_ptr<NeighbourSearch> clone() const = 0;
+
+        // Index the agents in `agent_indices`, or all the agents of the store
+        virtual void rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) = 0;
+        void rebuild(const AgentStore &agent_store);
+        virtual void update(int agent_index, const Point2D &old_location, const Point2D &new_location) = 0;
+
+        // True if an active agent, other than `agent_id`, is within `separation`
+        // of `location` and not behind it along the x axis.
+        [[nodiscard]] virtual bool collides(const AgentStore &agent_store, int agent_id,
+                                            const Point2D &location) const = 0;
+
+        // Fill `candidates` with the active agents, other than `agent_id`, within
+        // `radius` of `location`. Used to test several locations of a move
+        // against the same short list of agents.
+        virtual void find_candidates(const AgentStore &agent_store, int agent_id, const Point2D &location,
+                                     double radius, std::vector<int> &candidates) const = 0;
+
+        [[nodiscard]] float get_separation() const;
+        [[nodiscard]] double search_radius() const;
+
+        // Exact collision test between `location` and the agent at `index`
+        [[nodiscard]] bool is_blocking(const AgentStore &agent_store, int index, int agent_id,
+                                       const Point2D &location) const;
+
+      protected:
+        [[nodiscard]] bool is_candidate(const AgentStore &agent_store, int index, int agent_id,
+                                        const Point2D &location, double radius) const;
+    };
+
+    // Scans every agent of the store, whatever the indexed agents are
+    class BruteForceNeighbourSearch final : public NeighbourSearch {
+      public:
+        explicit BruteForceNeighbourSearch(float separation);
+
+        [[nodiscard]] std::unique_ptr<NeighbourSearch> clone() const override;
+        using NeighbourSearch::rebuild;
+        void rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) override;
+        void update(int agent_index, const Point2D &old_location, const Point2D &new_location) override;
+        [[nodiscard]] bool collides(const AgentStore &agent_store, int agent_id,
+                                    const Point2D &location) const override;
+        void find_candidates(const AgentStore &agent_store, int agent_id, const Point2D &location, double radius,
+                             std::vector<int> &candidates) const override;
+    };
+
+    // Uniform grid with cells of side `separation`, stored in a hash table of
+    // buckets so that the memory does not depend on the size of the station.
+    class UniformGridNeighbourSearch final : public NeighbourSearch {
+      private:
+        double cell_size;
+        unsigned int buckets_mask;
+        std::vector<std::vector<int>> buckets;
+        std::vector<unsigned int> agents_bucket;
+
+        static constexpr unsigned int not_indexed = ~0u;
+
+      public:
+        explicit UniformGridNeighbourSearch(float separation);
+
+        [[nodiscard]] std::unique_ptr<NeighbourSearch> clone() const override;
+        using NeighbourSearch::rebuild;
+        void rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) override;
+        void update(int agent_index, const Point2D &old_location, const Point2D &new_location) override;
+        [[nodiscard]] bool collides(const AgentStore &agent_store, int agent_id,
+                                    const Point2D &location) const override;
+        void find_candidates(const AgentStore &agent_store, int agent_id, const Point2D &location, double radius,
+                             std::vector<int> &candidates) const override;
+
+      private:
+        [[nodiscard]] int cell_index(double value) const;
+        [[nodiscard]] unsigned int bucket_index(int cell_x, int cell_y) const;
+        [[nodiscard]] unsigned int bucket_of(const Point2D &location) const;
+    };
+
+    // Agents sorted along the x axis. Only agents ahead of the queried location
+    // can collide with it, so a query is a binary search followed by a scan of
+    // the agents within `separation` in x.
+    class SortedSweepNeighbourSearch final : public NeighbourSearch {
+      private:
+        std::vector<std::pair<float, int>> sorted_agents;
+        std::vector<unsigned long> agents_slot;
+
+        static constexpr unsigned long not_indexed = ~0ul;
+
+      public:
+        explicit SortedSweepNeighbourSearch(float separation);
+
+        [[nodiscard]] std::unique_ptr<NeighbourSearch> clone() const override;
+        using NeighbourSearch::rebuild;
+        void rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) override;
+        void update(int agent_index, const Point2D &old_location, const Point2D &new_location) override;
+        [[nodiscard]] bool collides(const AgentStore &agent_store, int agent_id,
+                                    const Point2D &location) const override;
+        void find_candidates(const AgentStore &agent_store, int agent_id, const Point2D &location, double radius,
+                             std::vector<int> &candidates) const override;
+    };
+
+    // Verlet lists: every indexed agent lists the agents whose reference
+    // locations, their locations when they were indexed, are within
+    // `separation + skin` of its own. A query around an agent only tests its
+    // list, as long as the query and the moves of the agents since they were
+    // indexed fit in the skin. The model rebuilds the index every step, but
+    // the lists are only built again once an agent has moved by more than
+    // half the skin; the agents indexed in between are inserted in the lists
+    // of their neighbours. The queries the lists cannot answer scan all the
+    // indexed agents. The skin should be more than twice the largest speed
+    // of the agents for the lists to answer all the queries of the moves.
+    class VerletListNeighbourSearch final : public NeighbourSearch {
+      private:
+        enum class IndexState : char { not_indexed = 0, indexed = 1, removed = 2 };
+
+        float skin;
+        double list_radius;
+        std::vector<IndexState> index_states;
+        std::vector<int> indexed_agents;
+        std::vector<Point2D> reference_locations;
+        std::vector<std::pair<float, int>> sorted_references;
+        std::vector<std::vector<int>> neighbour_lists;
+        double max_displacement = 0;
+        unsigned long lists_builds_number = 0;
+
+      public:
+        VerletListNeighbourSearch(float separation, float skin);
+
+        [[nodiscard]] std::unique_ptr<NeighbourSearch> clone() const override;
+        using NeighbourSearch::rebuild;
+        void rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) override;
+        void update(int agent_index, const Point2D &old_location, const Point2D &new_location) override;
+        [[nodiscard]] bool collides(const AgentStore &agent_store, int agent_id,
+                                    const Point2D &location) const override;
+        void find_candidates(const AgentStore &agent_store, int agent_id, const Point2D &location, double radius,
+                             std::vector<int> &candidates) const override;
+
+        [[nodiscard]] float get_skin() const;
+        [[nodiscard]] unsigned long get_lists_builds_number() const;
+
+      private:
+        void build_lists(const AgentStore &agent_store, const std::vector<int> &agent_indices);
+        void insert_agent(int agent_index, const Point2D &location);
+        [[nodiscard]] bool lists_cover(int agent_id, const Point2D &location, double radius) const;
+        [[nodiscard]] double build_radius() const;
+        [[nodiscard]] static double distance(const Point2D &a, const Point2D &b);
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_NEIGHBOURSEARCH_HPP
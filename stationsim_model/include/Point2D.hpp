@@ -9,6 +9,7 @@
 #ifndef STATIONSIM_POINT2D_HPP
 #define STATIONSIM_POINT2D_HPP
 
+#include <cmath>
 #include <utility>
 
 namespace station_sim {
@@ -22,10 +23,19 @@ namespace station_sim {
 
         Point2D operator()(float x, float y);
 
-        float distance(Point2D p) const;
-        std::pair<float,Point2D> distance_projection(Point2D s1, Point2D s2) const;
+        inline float distance(Point2D p) const;
+        std::pair<float,Point2D> distance_projection(const Point2D &s1, const Point2D &s2) const;
     };
 
+    // Euclidean distance between two points. Defined here so that it is
+    // inlined in the collision tests; the squares of the differences of two
+    // floats cannot overflow in double precision.
+    inline float Point2D::distance(Point2D p) const {
+        double dx = static_cast<double>(this->x) - static_cast<double>(p.x);
+        double dy = static_cast<double>(this->y) - static_cast<double>(p.y);
+        return static_cast<float>(std::sqrt(dx * dx + dy * dy));
+    }
+
 } // namespace station_sim
 
 #endif // STATIONSIM_POINT2D_HPP
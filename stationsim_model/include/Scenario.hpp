@@ -0,0 +1,60 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_SCENARIO_HPP
+#define STATIONSIM_SCENARIO_HPP
+
+#include "Gate.hpp"
+#include "ModelParameters.hpp"
+#include "Point2D.hpp"
+#include "StationGeometry.hpp"
+#include <memory>
+#include <vector>
+
+namespace station_sim {
+    // Validated parameters of a simulation, with the data derived from them.
+    // A scenario never changes once built, so it is built once and shared by
+    // all the models, and particles, which simulate it.
+    class Scenario {
+      private:
+        ModelParameters model_parameters;
+
+        StationGeometry station_geometry;
+        float speed_step;
+        std::vector<Point2D> gates_in_locations;
+        std::vector<Point2D> gates_out_locations;
+
+      public:
+        explicit Scenario(const ModelParameters &model_parameters);
+        // Same, but the station geometry of `scenario` is reused if the
+        // station is the same
+        Scenario(const ModelParameters &model_parameters, const Scenario &scenario);
+
+        [[nodiscard]] static std::shared_ptr<const Scenario> create(const ModelParameters &model_parameters);
+        [[nodiscard]] static std::shared_ptr<const Scenario> create(const ModelParameters &model_parameters,
+                                                                    const Scenario &scenario);
+
+        [[nodiscard]] const ModelParameters &get_model_parameters() const;
+        [[nodiscard]] int get_population_total() const;
+        [[nodiscard]] const std::vector<Point2D> &get_agents_locations() const;
+        [[nodiscard]] const std::vector<Point2D> &get_boundary_vertices() const;
+        [[nodiscard]] const StationGeometry &get_station_geometry() const;
+        [[nodiscard]] const std::vector<Gate> &get_gates_in() const;
+        [[nodiscard]] const std::vector<Gate> &get_gates_out() const;
+        [[nodiscard]] const std::vector<Point2D> &get_gates_in_locations() const;
+        [[nodiscard]] const std::vector<Point2D> &get_gates_out_locations() const;
+        [[nodiscard]] float get_speed_step() const;
+
+      private:
+        void initialize_derived_data();
+        void validate() const;
+        [[nodiscard]] bool has_same_station(const ModelParameters &other_model_parameters) const;
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_SCENARIO_HPP
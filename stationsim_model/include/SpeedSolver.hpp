@@ -0,0 +1,89 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_SPEEDSOLVER_HPP
+#define STATIONSIM_SPEEDSOLVER_HPP
+
+#include "Point2D.hpp"
+#include "StationGeometry.hpp"
+#include <vector>
+
+namespace station_sim {
+    class AgentStore;
+    class NeighbourSearch;
+
+    // Speeds, along the direction of the move, for which an agent collides
+    // with another one. `outer` is computed against the agent inflated by the
+    // margin of the solver and `inner` against the deflated one.
+    struct BlockingInterval {
+        int agent_index;
+        double outer_start, outer_end;
+        double inner_start, inner_end;
+    };
+
+    // Decides which speeds of the ladder of an agent are admissible. The
+    // locations tried by a move are `location + speed * direction`, so the
+    // agents which can block any of them are found once, and for each of them
+    // the interval of blocked speeds is solved analytically in double
+    // precision. Only the speeds too close to the end of an interval, or to
+    // the boundaries, for the rounding errors to be ignored are tested with
+    // the exact single precision tests used before, so the results are the
+    // same.
+    class SpeedSolver {
+      private:
+        const AgentStore *agent_store = nullptr;
+        const NeighbourSearch *neighbour_search = nullptr;
+        const StationGeometry *station_geometry = nullptr;
+        int agent_id = 0;
+        bool solved = false;
+        double boundaries_free_speed = 0;
+        std::vector<int> candidates;
+        std::vector<BlockingInterval> blocking_intervals;
+
+      public:
+        SpeedSolver() = default;
+        // The solver only holds work buffers, copies start empty
+        SpeedSolver(const SpeedSolver &) {}
+        SpeedSolver &operator=(const SpeedSolver &) { return *this; }
+        ~SpeedSolver() = default;
+
+        void solve(const AgentStore &agent_store, const NeighbourSearch &neighbour_search,
+                   const StationGeometry &station_geometry, int agent_id, const Point2D &direction,
+                   float max_speed, float min_speed);
+
+        // Same as testing whether `new_location`, the location reached with
+        // `speed`, is outside the boundaries or collides with another agent
+        [[nodiscard]] bool is_blocked(float speed, const Point2D &new_location) const;
+
+        // Inflation of the obstacles, large enough to cover the rounding errors
+        // of the single precision tests around `location`
+        [[nodiscard]] static double margin(const Point2D &location, float separation, float max_speed);
+
+        // Interval of speeds for which the agent at `location` moves within
+        // `separation` of `other` and not behind it along the x axis. Empty if
+        // `start > end`.
+        static void agent_blocking_interval(const Point2D &location, const Point2D &direction, const Point2D &other,
+                                            double separation, double x_tolerance, double &start, double &end);
+
+        // Largest speed before getting within `margin` of the edges of the
+        // station, zero if `location` is not inside the station
+        [[nodiscard]] static double boundaries_free_distance(const StationGeometry &station_geometry,
+                                                             const Point2D &location, const Point2D &direction,
+                                                             double margin);
+
+      private:
+        // First non negative `s` at which `w + s * d` is within `radius` of the
+        // origin, infinity if it never is
+        [[nodiscard]] static double disk_entry(double w_x, double w_y, double d_x, double d_y, double radius);
+        // Interval of `s` in which `value + s * rate` is within [lower, upper]
+        static void slab_interval(double value, double rate, double lower, double upper, double &s_start,
+                                  double &s_end);
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_SPEEDSOLVER_HPP
@@ -0,0 +1,101 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_STATIONGEOMETRY_HPP
+#define STATIONSIM_STATIONGEOMETRY_HPP
+
+#include "Point2D.hpp"
+#include <vector>
+
+namespace station_sim {
+    // Edge from `first` to `second`, a pair of consecutive vertices of a
+    // ring. The differences are those of the even-odd test, computed once.
+    struct GeometryEdge {
+        Point2D first;
+        Point2D second;
+        float delta_x;
+        float delta_y;
+    };
+
+    // Walkable region of a station: the polygon of the boundaries minus the
+    // polygons of the obstacles (pillars, kiosks, barriers...) inside it.
+    // The edges are indexed by horizontal bands, so testing whether a point
+    // is outside the region only looks at the edges crossing the band of the
+    // point. The even-odd test on them gives the same results as testing all
+    // the edges. A region which is a single axis-aligned rectangle is tested
+    // with four comparisons.
+    //
+    // Optionally, the geometry is also rasterised in square cells. A cell
+    // further than its half diagonal from all the edges is entirely inside or
+    // outside, and a location in it is tested with a lookup. Each cell also
+    // lists the edges which can be the closest to a location in it, so the
+    // closest point of the edges is searched among those only. Locations in
+    // cells near the edges, or out of the raster, fall back to the exact
+    // tests, so the results do not depend on the raster.
+    class StationGeometry {
+      private:
+        std::vector<Point2D> boundary_vertices;
+        std::vector<std::vector<Point2D>> obstacles;
+        std::vector<GeometryEdge> edges;
+
+        bool axis_aligned_rectangle = false;
+        float min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+
+        // The edges of band `b` are `band_edges[band_offsets[b]...band_offsets[b + 1]]`
+        float band_height = 1;
+        std::vector<unsigned long> band_offsets;
+        std::vector<int> band_edges;
+
+        // Raster of `raster_columns * raster_rows` cells, by rows, from
+        // `raster_origin`. A side is 1 outside, -1 inside, 0 if unknown.
+        // The candidate edges of cell `c` are
+        // `raster_edges[raster_offsets[c]...raster_offsets[c + 1]]`.
+        float raster_cell_size = 0;
+        Point2D raster_origin;
+        unsigned long raster_columns = 0;
+        unsigned long raster_rows = 0;
+        std::vector<signed char> raster_sides;
+        std::vector<unsigned long> raster_offsets;
+        std::vector<int> raster_edges;
+
+        // Cells of the raster around the station, for the locations just
+        // outside of it which are clipped
+        static constexpr unsigned long raster_padding = 4;
+        static constexpr unsigned long max_raster_cells = 1ul << 26;
+
+      public:
+        StationGeometry() = default;
+        // A `raster_cell_size` of 0 does not build the raster
+        StationGeometry(const std::vector<Point2D> &boundary_vertices,
+                        const std::vector<std::vector<Point2D>> &obstacles, float raster_cell_size = 0);
+
+        // Based on the even-odd rule, over the edges of all the rings
+        [[nodiscard]] bool is_outside(const Point2D &location) const;
+        // Closest point of the edges to `location`
+        [[nodiscard]] Point2D closest_edge_point(const Point2D &location) const;
+
+        [[nodiscard]] const std::vector<Point2D> &get_boundary_vertices() const;
+        [[nodiscard]] const std::vector<std::vector<Point2D>> &get_obstacles() const;
+        [[nodiscard]] const std::vector<GeometryEdge> &get_edges() const;
+        [[nodiscard]] bool is_axis_aligned_rectangle() const;
+        [[nodiscard]] bool has_raster() const;
+        [[nodiscard]] float get_raster_cell_size() const;
+
+      private:
+        void add_ring(const std::vector<Point2D> &vertices);
+        void build_bands();
+        [[nodiscard]] unsigned long band_index(float y) const;
+        [[nodiscard]] static bool crosses_ray(const GeometryEdge &edge, const Point2D &location);
+        [[nodiscard]] bool is_outside_exact(const Point2D &location) const;
+        void build_raster(float cell_size);
+        [[nodiscard]] bool find_raster_cell(const Point2D &location, unsigned long &cell) const;
+        [[nodiscard]] static double edge_distance(const GeometryEdge &edge, double x, double y);
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_STATIONGEOMETRY_HPP
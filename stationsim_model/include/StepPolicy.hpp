@@ -0,0 +1,40 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_STEPPOLICY_HPP
+#define STATIONSIM_STEPPOLICY_HPP
+
+#include "NeighbourSearch.hpp"
+
+namespace station_sim {
+    // Options of a model run fixed at compile time in the step kernels of
+    // `Model` and `Agent`, so that the kernel of a run without history or
+    // printing has no branches on them and calls the neighbour search backend
+    // directly. `Model` picks the instantiation matching its parameters.
+    template <bool DoHistory, bool DoPrint, class NeighbourSearchBackend>
+    struct StepPolicy {
+        static constexpr bool do_history = DoHistory;
+        static constexpr bool do_print = DoPrint;
+        using neighbour_search_backend = NeighbourSearchBackend;
+    };
+
+// Apply `MACRO` to every step policy, e.g. to instantiate the kernels. The
+// policies contain commas, so `MACRO` has to be variadic.
+#define STATIONSIM_FOR_EACH_STEP_POLICY_OF_BACKEND(MACRO, BACKEND)                                                    \
+    MACRO(StepPolicy<false, false, BACKEND>)                                                                          \
+    MACRO(StepPolicy<false, true, BACKEND>)                                                                           \
+    MACRO(StepPolicy<true, false, BACKEND>)                                                                           \
+    MACRO(StepPolicy<true, true, BACKEND>)
+#define STATIONSIM_FOR_EACH_STEP_POLICY(MACRO)                                                                        \
+    STATIONSIM_FOR_EACH_STEP_POLICY_OF_BACKEND(MACRO, BruteForceNeighbourSearch)                                      \
+    STATIONSIM_FOR_EACH_STEP_POLICY_OF_BACKEND(MACRO, UniformGridNeighbourSearch)                                     \
+    STATIONSIM_FOR_EACH_STEP_POLICY_OF_BACKEND(MACRO, SortedSweepNeighbourSearch)                                     \
+    STATIONSIM_FOR_EACH_STEP_POLICY_OF_BACKEND(MACRO, VerletListNeighbourSearch)
+} // namespace station_sim
+
+#endif // STATIONSIM_STEPPOLICY_HPP
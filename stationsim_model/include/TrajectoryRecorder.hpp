@@ -0,0 +1,85 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#ifndef STATIONSIM_TRAJECTORYRECORDER_HPP
+#define STATIONSIM_TRAJECTORYRECORDER_HPP
+
+#include "Point2D.hpp"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace station_sim {
+    // Append-only record of the locations of all the agents of a model, one
+    // frame every `stride` steps. The frames are kept in fixed-size chunks,
+    // allocated as the steps are recorded. When the chunks in memory take more
+    // than `memory_limit` bytes, the oldest full chunks are written to a
+    // temporary file and read back on access. A `memory_limit` of 0 keeps
+    // everything in memory.
+    class TrajectoryRecorder {
+      private:
+        struct Chunk {
+            std::vector<Point2D> locations;
+            long spill_offset = -1;
+        };
+
+        struct FileCloser {
+            void operator()(std::FILE *file) const { std::fclose(file); }
+        };
+
+        unsigned long agents_number = 0;
+        int stride = 1;
+        unsigned long memory_limit = 0;
+        unsigned long frames_per_chunk = 1;
+
+        unsigned long frames_number = 0;
+        std::vector<double> frame_times;
+        std::vector<Chunk> chunks;
+        unsigned long first_chunk_in_memory = 0;
+        std::unique_ptr<std::FILE, FileCloser> spill_file;
+
+        // Emptied chunk buffers kept by `reset`, reused by the next chunks
+        std::vector<std::vector<Point2D>> spare_chunks;
+
+        // Target size of a chunk
+        static constexpr unsigned long chunk_bytes = 1 << 20;
+
+      public:
+        TrajectoryRecorder() = default;
+        TrajectoryRecorder(unsigned long agents_number, int stride, unsigned long memory_limit);
+        TrajectoryRecorder(const TrajectoryRecorder &trajectory_recorder);
+        TrajectoryRecorder &operator=(const TrajectoryRecorder &trajectory_recorder);
+        ~TrajectoryRecorder() = default;
+
+        // Drop all the frames and start again with the given settings. The
+        // chunk buffers in memory are kept for the new frames if the size of
+        // a chunk does not change.
+        void reset(unsigned long agents_number, int stride, unsigned long memory_limit);
+
+        // Record `locations` if `step` is a multiple of the stride. `time` is
+        // the time of the step, in time units, the step itself by default.
+        void record(int step, const std::vector<Point2D> &locations);
+        void record(int step, const std::vector<Point2D> &locations, double time);
+        [[nodiscard]] bool is_recorded(int step) const;
+
+        [[nodiscard]] unsigned long get_frames_number() const;
+        [[nodiscard]] int get_frame_step(unsigned long frame) const;
+        [[nodiscard]] double get_frame_time(unsigned long frame) const;
+        [[nodiscard]] int get_stride() const;
+        [[nodiscard]] unsigned long get_memory_usage() const;
+        [[nodiscard]] std::vector<Point2D> get_frame(unsigned long frame) const;
+        [[nodiscard]] std::vector<Point2D> get_agent_trajectory(int agent_id) const;
+
+      private:
+        [[nodiscard]] unsigned long chunk_size() const;
+        [[nodiscard]] std::vector<Point2D> read_chunk(unsigned long chunk) const;
+        void spill_chunks();
+    };
+} // namespace station_sim
+
+#endif // STATIONSIM_TRAJECTORYRECORDER_HPP
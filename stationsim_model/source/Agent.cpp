@@ -10,6 +10,9 @@
 #include "Point2D.hpp"
 #include "HelpFunctions.hpp"
 #include "Model.hpp"
+#include "SpeedSolver.hpp"
+#include "StationGeometry.hpp"
+#include "StepPolicy.hpp"
 #include <algorithm>
 #include <limits>
 #include <cmath>
@@ -18,281 +21,291 @@
 #include <vector>
 
 namespace station_sim {
-    Agent::Agent(int unique_id, const Model &model, const ModelParameters &model_parameters,
-                 std::shared_ptr<std::mt19937> generator) {
-        status = AgentStatus::not_started; // 0 Not Started, 1 Active, 2 Finished
+    Agent::Agent(int unique_id, AgentStore &agent_store) {
+        this->agent_store = &agent_store;
         agent_id = unique_id;
+        store_slot = agent_store.slots[static_cast<unsigned long>(unique_id)];
+    }
 
-        this->random_number_generator = generator;
-
-        initialize_random_distributions(model_parameters);
-
-        initialize_start_location(model, model_parameters);
-        initialize_desired_location(model, model_parameters);
-        agent_location = start_location;
-        initialize_speed(model, model_parameters);
+    Agent::Agent(int unique_id, AgentStore &agent_store, const Model &model, const ModelParameters &model_parameters)
+        : Agent(unique_id, agent_store) {
+        agent_store.statuses[store_slot] = AgentStatus::not_started; // 0 Not Started, 1 Active, 2 Finished
 
-        steps_activate = gates_speed_exponential_distribution(*generator);
-        wiggle = std::fmin(model_parameters.get_max_wiggle(), agent_max_speed);
+        CounterRandomEngine random_engine = model.get_random_engine(RandomStream::agent_initialisation, agent_id);
+        initialize_start_location(model, model_parameters, random_engine);
+        initialize_desired_location(model, random_engine);
+        agent_store.locations[store_slot] = agent_store.cold_data[store_slot].start_location;
+        initialize_speed(model, model_parameters, random_engine);
+        initialize_activation(model_parameters, random_engine);
     }
 
     // Same as above, but provide the initial location of the agent, instead of
     // generating it randomly around the entrance gates.
-    Agent::Agent(int unique_id, const Point2D location, const Model &model,
-                 const ModelParameters &model_parameters, std::shared_ptr<std::mt19937> generator) {
-        status = AgentStatus::not_started; // 0 Not Started, 1 Active, 2 Finished
-        agent_id = unique_id;
-
-        this->random_number_generator = generator;
+    Agent::Agent(int unique_id, const Point2D location, AgentStore &agent_store, const Model &model,
+                 const ModelParameters &model_parameters)
+        : Agent(unique_id, agent_store) {
+        agent_store.statuses[store_slot] = AgentStatus::not_started; // 0 Not Started, 1 Active, 2 Finished
+
+        CounterRandomEngine random_engine = model.get_random_engine(RandomStream::agent_initialisation, agent_id);
+        initialize_desired_location(model, random_engine);
+        agent_store.cold_data[store_slot].start_location = location;
+        agent_store.locations[store_slot] = location;
+        initialize_speed(model, model_parameters, random_engine);
+        initialize_activation(model_parameters, random_engine);
+    }
 
-        initialize_random_distributions(model_parameters);
+    void Agent::set_agent_store(AgentStore &agent_store) { this->agent_store = &agent_store; }
 
-        initialize_desired_location(model, model_parameters);
-        start_location = location;
-        agent_location = start_location;
-        initialize_speed(model, model_parameters);
+    void Agent::set_store_slot(int slot) { store_slot = slot; }
 
-        steps_activate = gates_speed_exponential_distribution(*generator);
-        wiggle = std::fmin(model_parameters.get_max_wiggle(), agent_max_speed);
-    }
+    int Agent::get_store_slot() const { return store_slot; }
 
-    Agent::Agent(const Agent &agent) {
-        random_number_generator = agent.random_number_generator;
-
-        float_distribution = agent.float_distribution;
-        gates_in_int_distribution = agent.gates_in_int_distribution;
-        gates_out_int_distribution = agent.gates_out_int_distribution;
-        gates_speed_exponential_distribution = agent.gates_speed_exponential_distribution;
-        speed_normal_distribution = agent.speed_normal_distribution;
-        wiggle_int_distribution = agent.wiggle_int_distribution;
-
-        agent_id = agent.agent_id;
-
-        steps_activate = agent.steps_activate;
-        wiggle = agent.wiggle;
-        agent_max_speed = agent.agent_max_speed;
-        agent_available_speeds = agent.agent_available_speeds;
-        agent_speed = agent.agent_speed;
-        history_locations = agent.history_locations;
-
-        history_speeds = agent.history_speeds;
-        history_wiggles = agent.history_wiggles;
-        history_collisions = agent.history_collisions;
-        step_start = agent.step_start;
-        status = agent.status;
-
-        steps_taken = agent.steps_taken;
-        gate_in = agent.gate_in;
-        gate_out = agent.gate_out;
-        start_location = agent.start_location;
-
-        desired_location = agent.desired_location;
-        agent_location = agent.agent_location;
-        steps_delay = agent.steps_delay;
-    }
+    void Agent::initialize_start_location(const Model &model, const ModelParameters &model_parameters,
+                                          CounterRandomEngine &random_engine) {
+        AgentColdData &cold_data = agent_store->cold_data[store_slot];
 
-    void Agent::initialize_random_distributions(const ModelParameters &model_parameters) {
-        float_distribution = std::uniform_real_distribution<float>(-1, 1);
-        gates_in_int_distribution = std::uniform_int_distribution<int>(0, model_parameters.get_gates_in_count() - 1);
-        gates_out_int_distribution = std::uniform_int_distribution<int>(0, model_parameters.get_gates_out_count() - 1);
-        gates_speed_exponential_distribution = std::exponential_distribution<float>(model_parameters.get_gates_speed());
-        speed_normal_distribution =
-            std::normal_distribution<float>(model_parameters.get_speed_mean(), model_parameters.get_speed_std());
-        wiggle_int_distribution = std::uniform_int_distribution<int>(-1, 1);
+        float perturb = agent_store->float_distribution(random_engine) * model_parameters.get_gates_space();
+        cold_data.gate_in = agent_store->gates_in_int_distribution(random_engine);
+        cold_data.start_location = model.get_scenario().get_gates_in_locations()[cold_data.gate_in];
+        cold_data.start_location.y += perturb;
     }
 
-    void Agent::initialize_start_location(const Model &model, const ModelParameters &model_parameters) {
-        float perturb = float_distribution(*random_number_generator) * model_parameters.get_gates_space();
-        gate_in = gates_in_int_distribution(*random_number_generator);
-        start_location.x = model.get_gates_in()[gate_in].position.x;
-        start_location.y = model.get_gates_in()[gate_in].position.y;
-        start_location.y += perturb;
-    }
+    void Agent::initialize_desired_location(const Model &model, CounterRandomEngine &random_engine) {
+        AgentColdData &cold_data = agent_store->cold_data[store_slot];
 
-    void Agent::initialize_desired_location(const Model &model, const ModelParameters &model_parameters) {
-        gate_out = gates_out_int_distribution(*random_number_generator);
-        desired_location.x = model.get_gates_out()[gate_out].position.x;
-        desired_location.y = model.get_gates_out()[gate_out].position.y;
+        cold_data.gate_out = agent_store->gates_out_int_distribution(random_engine);
+        agent_store->desired_locations[store_slot] =
+            model.get_scenario().get_gates_out_locations()[cold_data.gate_out];
     }
 
-    void Agent::initialize_speed(const Model &model, const ModelParameters &model_parameters) {
-        agent_speed = 0;
-        agent_max_speed = 0;
+    void Agent::initialize_speed(const Model &model, const ModelParameters &model_parameters,
+                                 CounterRandomEngine &random_engine) {
+        float agent_max_speed = 0;
 
+        // The normal distribution keeps a spare number between calls, which
+        // would come from the engine of the previous agent
+        agent_store->speed_normal_distribution.reset();
         while (agent_max_speed <= model_parameters.get_speed_min()) {
-            agent_max_speed = speed_normal_distribution(*random_number_generator);
+            agent_max_speed = agent_store->speed_normal_distribution(random_engine);
         }
 
-        agent_available_speeds = HelpFunctions::evenly_spaced_values_within_interval(
+        agent_store->speeds[store_slot] = 0;
+        agent_store->max_speeds[store_slot] = agent_max_speed;
+        agent_store->cold_data[store_slot].available_speeds = HelpFunctions::evenly_spaced_values_within_interval(
             agent_max_speed, model_parameters.get_speed_min(), -model.get_speed_step());
     }
 
-    void Agent::step(Model &model, const ModelParameters &model_parameters) {
-        if (status == AgentStatus::not_started) {
-            activate_agent(model);
-            move_agent(model, model_parameters);
-        } else if (status == AgentStatus::active) {
-            move_agent(model, model_parameters);
-            deactivate_agent_if_reached_exit_gate(model, model_parameters);
-        }
+    void Agent::initialize_activation(const ModelParameters &model_parameters, CounterRandomEngine &random_engine) {
+        agent_store->cold_data[store_slot].steps_activate =
+            static_cast<int>(agent_store->gates_speed_exponential_distribution(random_engine));
+        agent_store->wiggles[store_slot] =
+            std::fmin(model_parameters.get_max_wiggle(), agent_store->max_speeds[store_slot]);
+    }
 
-        if (model_parameters.is_do_history()) {
-            add_agent_location_history();
+    template <class StepPolicy>
+    void Agent::step(Model &model, const ModelParameters &model_parameters) {
+        // Agents are activated by `Model` when their activation step is due
+        if (agent_store->statuses[store_slot] == AgentStatus::active) {
+            move_agent<StepPolicy>(model);
+            deactivate_agent_if_reached_exit_gate<StepPolicy>(model, model_parameters);
         }
     }
 
     void Agent::activate_agent(Model &model) {
-        status = AgentStatus::active;
+        agent_store->statuses[store_slot] = AgentStatus::active;
         model.pop_active += 1;
-        step_start = model.step_id;
+        agent_store->cold_data[store_slot].step_start = static_cast<float>(model.get_time());
     }
 
-    void Agent::move_agent(Model &model, const ModelParameters &model_parameters) {
-        Point2D direction = calculate_agent_direction();
-        Point2D new_agent_location(0, 0);
-        float new_speed = 0;
+    template <class StepPolicy>
+    void Agent::move_agent(Model &model) {
+        const Point2D agent_location = agent_store->locations[store_slot];
+        AgentMove move = propose_move<StepPolicy>(model, model.get_speed_solver(0), model.get_move_history(0));
+
+        model.update_agent_location_in_neighbour_search(store_slot, agent_location, move.location);
+        agent_store->locations[store_slot] = move.location;
+        agent_store->speeds[store_slot] = move.speed;
+    }
+
+    template <class StepPolicy>
+    AgentMove Agent::propose_move(const Model &model, SpeedSolver &speed_solver, AgentMoveHistory &move_history) {
+        if (model.is_free_flowing(agent_id)) {
+            return find_free_flow_move(model);
+        }
+
+        AgentMove move = find_move<StepPolicy>(model, speed_solver, move_history);
+        finish_move<StepPolicy>(model, move, move_history);
+        return move;
+    }
+
+    // Find the fastest available speed which keeps the agent within the
+    // boundaries without colliding, or flag that the agent has to wiggle
+    template <class StepPolicy>
+    AgentMove Agent::find_move(const Model &model, SpeedSolver &speed_solver, AgentMoveHistory &move_history) {
+        const Point2D &agent_location = agent_store->locations[store_slot];
+        const std::vector<float> &agent_available_speeds = agent_store->cold_data[store_slot].available_speeds;
+        AgentHistory &history = agent_store->histories[store_slot];
+
+        Point2D direction = calculate_agent_step_direction(model);
+        AgentMove move;
+
+        // Most agents move at their fastest speed, which is tested directly.
+        // If it is blocked, the remaining speeds are left to the solver, unless
+        // they are too few to pay for its setup.
+        bool solver_ready = false;
+        std::vector<float>::size_type speeds_left = agent_available_speeds.size();
 
         for (const auto &speed : agent_available_speeds) {
-            new_speed = speed;
-            new_agent_location.x = agent_location.x + speed * direction.x;
-            new_agent_location.y = agent_location.y + speed * direction.y;
-
-            if (is_outside_boundaries(model.boundary_vertices, new_agent_location) ||
-                collides_other_agent(model, model_parameters, new_agent_location)) {
-                if (model_parameters.is_do_history()) {
-                    history_collisions += 1;
-                    model.add_to_history_collision_locations(new_agent_location);
+            speeds_left--;
+            move.speed = speed;
+            move.location.x = agent_location.x + speed * direction.x;
+            move.location.y = agent_location.y + speed * direction.y;
+
+            bool blocked;
+            if (!solver_ready) {
+                blocked = model.get_station_geometry().is_outside(move.location) ||
+                          collides_other_agent<StepPolicy>(model, move.location);
+                if (blocked && speeds_left > min_solver_speeds) {
+                    speed_solver.solve(*agent_store, model.get_neighbour_search(), model.get_station_geometry(),
+                                       store_slot, direction, speed, agent_available_speeds.back());
+                    solver_ready = true;
                 }
             } else {
-                break;
+                blocked = speed_solver.is_blocked(speed, move.location);
             }
 
-            // If even the slowest speed results in a collision, then wiggle.
-            if (speed == agent_available_speeds.back()) {
-                new_agent_location.x = agent_location.x;
-                new_agent_location.y = agent_location.y + wiggle * wiggle_int_distribution(*random_number_generator);
-
-                if (model_parameters.is_do_history()) {
-                    history_wiggles += 1;
-                    model.add_to_history_wiggle_locations(new_agent_location);
-                }
+            if (!blocked) {
+                return move;
             }
-        }
 
-        if (is_outside_boundaries(model.boundary_vertices, new_agent_location)) {
-            clip_vector_values_to_boundaries(new_agent_location, model.boundary_vertices);
+            if constexpr (StepPolicy::do_history) {
+                history.collisions += 1;
+                move_history.collision_locations.push_back(move.location);
+            }
         }
 
-        agent_location = new_agent_location;
-        agent_speed = new_speed;
+        // If even the slowest speed results in a collision, then wiggle.
+        move.wiggle = !agent_available_speeds.empty();
+        return move;
     }
 
-    // Assuming `location` is outside of `boundary_vertices`, move it to the closest
-    // point of the region within boundaries
-    void Agent::clip_vector_values_to_boundaries(Point2D &location, std::vector<Point2D> boundary_vertices) {
-        float min_distance = std::numeric_limits<float>::max();
-        Point2D closest_point = location;
-
-        // Loop over all edges of the boundaries (i.e., all segments) and find
-        // the one closest to the point
-        for (std::vector<Point2D>::size_type index = 0; index < boundary_vertices.size() - 1; ++index) {
-            // Extrema of the edge
-            Point2D s1 = boundary_vertices.at(index);
-            Point2D s2 = boundary_vertices.at(index + 1);
-            // Determine distance of location from the edge and its projection
-            // (_within_ the segment), update closest point if necessary
-            std::pair<float,Point2D> this_distance_projection = location.distance_projection(s1, s2);
-            float this_distance = this_distance_projection.first;
-            Point2D this_projection = this_distance_projection.second;
-            if (this_distance < min_distance) {
-                min_distance = this_distance;
-                closest_point = this_projection;
+    template <class StepPolicy>
+    void Agent::finish_move(const Model &model, AgentMove &move, AgentMoveHistory &move_history) {
+        if (move.wiggle) {
+            int wiggle_direction = model.draw_wiggle_direction(agent_id);
+            const Point2D &agent_location = agent_store->locations[store_slot];
+            move.location.x = agent_location.x;
+            move.location.y = agent_location.y + agent_store->wiggles[store_slot] * model.get_time_step() *
+                                                     static_cast<float>(wiggle_direction);
+
+            if constexpr (StepPolicy::do_history) {
+                agent_store->histories[store_slot].wiggles += 1;
+                move_history.wiggle_locations.push_back(move.location);
             }
         }
 
-        // Move location to the closest point
-        location = closest_point;
+        // A location outside of the station is moved to the closest point of
+        // its edges
+        const StationGeometry &station_geometry = model.get_station_geometry();
+        if (station_geometry.is_outside(move.location)) {
+            move.location = station_geometry.closest_edge_point(move.location);
+        }
+    }
+
+    // The fastest speed is never blocked for a free flowing agent, so this is
+    // the move `find_move` and `finish_move` would give, computed the same
+    // way, without the tests
+    AgentMove Agent::find_free_flow_move(const Model &model) const {
+        const Point2D &agent_location = agent_store->locations[store_slot];
+        Point2D direction = calculate_agent_step_direction(model);
+
+        AgentMove move;
+        move.speed = agent_store->cold_data[store_slot].available_speeds[0];
+        move.location.x = agent_location.x + move.speed * direction.x;
+        move.location.y = agent_location.y + move.speed * direction.y;
+        return move;
     }
 
-    Point2D Agent::calculate_agent_direction() {
+    Point2D Agent::calculate_agent_direction() const {
+        const Point2D &agent_location = agent_store->locations[store_slot];
+        const Point2D &desired_location = agent_store->desired_locations[store_slot];
         float distance = desired_location.distance(agent_location);
 
         return Point2D((desired_location.x - agent_location.x) / distance,
                        (desired_location.y - agent_location.y) / distance);
     }
 
+    // Move of the agent per unit of speed over a step of the model
+    Point2D Agent::calculate_agent_step_direction(const Model &model) const {
+        Point2D direction = calculate_agent_direction();
+        direction.x *= model.get_time_step();
+        direction.y *= model.get_time_step();
+        return direction;
+    }
+
     // Based on the even-odd rule: https://en.wikipedia.org/wiki/Even%E2%80%93odd_rule#Implementation
-    bool Agent::is_outside_boundaries(const std::vector<Point2D> boundary_vertices, const Point2D &location) {
-        int len = boundary_vertices.size();
-        int j = len - 1;
-        bool inside = false;
-        for (int i = 0; i < len; i++) {
-            if (((boundary_vertices[i].y > location.y) != (boundary_vertices[j].y > location.y)) &&
-                (location.x < boundary_vertices[i].x + (boundary_vertices[j].x - boundary_vertices[i].x) * (location.y - boundary_vertices[i].y) /
-                 (boundary_vertices[j].y - boundary_vertices[i].y)))
-                inside = !inside;
-            j = i;
-        }
-        return !inside;
+    // The models test their compiled `StationGeometry` instead, which does
+    // not have to be built for every location.
+    bool Agent::is_outside_boundaries(const std::vector<Point2D> &boundary_vertices, const Point2D &location) {
+        return StationGeometry(boundary_vertices, {}).is_outside(location);
     }
 
-    bool Agent::collides_other_agent(const Model &model, const ModelParameters &model_parameters,
-                                     const Point2D &location) const {
-        for (const auto &agent : model.agents) {
-            if (agent.agent_id != agent_id && agent.status == AgentStatus::active &&
-                location.distance(agent.get_agent_location()) <= model_parameters.get_separation() &&
-                location.x <= agent.get_agent_location().x) {
-                return true;
-            }
-        }
-        return false;
+    // The backends are final, so the call is not virtual
+    template <class StepPolicy>
+    bool Agent::collides_other_agent(const Model &model, const Point2D &location) const {
+        using NeighbourSearchBackend = typename StepPolicy::neighbour_search_backend;
+        const auto &neighbour_search = static_cast<const NeighbourSearchBackend &>(model.get_neighbour_search());
+        return neighbour_search.collides(*agent_store, store_slot, location);
     }
 
+    template <class StepPolicy>
     void Agent::deactivate_agent_if_reached_exit_gate(Model &model, const ModelParameters &model_parameters) {
-        if (agent_location.distance(desired_location) < model_parameters.get_gates_space()) {
-            status = AgentStatus::finished;
+        const Point2D &desired_location = agent_store->desired_locations[store_slot];
+        if (agent_store->locations[store_slot].distance(desired_location) < model_parameters.get_gates_space()) {
+            agent_store->statuses[store_slot] = AgentStatus::finished;
             model.pop_active -= 1;
             model.pop_finished += 1;
 
-            if (model_parameters.is_do_history()) {
+            if constexpr (StepPolicy::do_history) {
+                AgentColdData &cold_data = agent_store->cold_data[store_slot];
                 float steps_expected =
-                    (start_location.distance(desired_location) - model_parameters.get_gates_space()) /
-                    agent_available_speeds[0];
+                    (cold_data.start_location.distance(desired_location) - model_parameters.get_gates_space()) /
+                    cold_data.available_speeds[0];
                 model.steps_expected.push_back(steps_expected);
-                steps_taken = model.step_id - step_start;
-                model.steps_taken.push_back(steps_taken);
-                steps_delay = steps_taken - steps_expected;
-                model.steps_delay.push_back(steps_delay);
+                cold_data.steps_taken = static_cast<float>(model.get_time()) - cold_data.step_start;
+                model.steps_taken.push_back(cold_data.steps_taken);
+                cold_data.steps_delay = cold_data.steps_taken - steps_expected;
+                model.steps_delay.push_back(cold_data.steps_delay);
             }
         }
     }
 
-    const Point2D &Agent::get_agent_location() const { return agent_location; }
-
-    float Agent::get_agent_speed() const { return agent_speed; }
+    const Point2D &Agent::get_agent_location() const { return agent_store->locations[store_slot]; }
 
-    int Agent::get_history_wiggles() const { return history_wiggles; }
+    float Agent::get_agent_speed() const { return agent_store->speeds[store_slot]; }
 
-    int Agent::get_history_collisions() const { return history_collisions; }
+    int Agent::get_history_wiggles() const { return agent_store->histories[store_slot].wiggles; }
 
-    const std::vector<Point2D> &Agent::get_history_locations() const { return history_locations; }
-
-    void Agent::add_agent_location_history() { history_locations.push_back(agent_location); }
+    int Agent::get_history_collisions() const { return agent_store->histories[store_slot].collisions; }
 
     int Agent::get_agent_id() const { return agent_id; }
 
-    void Agent::set_agent_location(const Point2D &agent_location) { this->agent_location = agent_location; }
+    void Agent::set_agent_location(const Point2D &agent_location) { agent_store->locations[store_slot] = agent_location; }
 
-    AgentStatus Agent::getStatus() const { return status; }
+    AgentStatus Agent::getStatus() const { return agent_store->statuses[store_slot]; }
 
-    void Agent::set_status(AgentStatus status) { this->status = status; }
+    void Agent::set_status(AgentStatus status) { agent_store->statuses[store_slot] = status; }
 
-    void Agent::set_random_number_generator(const std::shared_ptr<std::mt19937> &random_number_generator) {
-        Agent::random_number_generator = random_number_generator;
+    void Agent::set_desired_location(const Point2D &desired_location) {
+        agent_store->desired_locations[store_slot] = desired_location;
     }
 
-    void Agent::set_desired_location(const Point2D &desired_location) { this->desired_location = desired_location; }
-
-    const Point2D &Agent::get_desired_location() const { return desired_location; }
+    const Point2D &Agent::get_desired_location() const { return agent_store->desired_locations[store_slot]; }
 
+#define STATIONSIM_INSTANTIATE_AGENT_STEP(...)                                                                        \
+    template void Agent::step<__VA_ARGS__>(Model &, const ModelParameters &);                                         \
+    template AgentMove Agent::propose_move<__VA_ARGS__>(const Model &, SpeedSolver &, AgentMoveHistory &);            \
+    template void Agent::deactivate_agent_if_reached_exit_gate<__VA_ARGS__>(Model &, const ModelParameters &);
+    STATIONSIM_FOR_EACH_STEP_POLICY(STATIONSIM_INSTANTIATE_AGENT_STEP)
+#undef STATIONSIM_INSTANTIATE_AGENT_STEP
 } // namespace station_sim
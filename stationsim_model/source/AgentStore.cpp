@@ -0,0 +1,159 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "AgentStore.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <tuple>
+
+namespace station_sim {
+    void AgentStore::resize(unsigned long size) {
+        unsigned long old_size = ids.size();
+        ids.resize(size);
+        slots.resize(size);
+        for (unsigned long i = old_size; i < size; i++) {
+            ids[i] = static_cast<int>(i);
+            slots[i] = static_cast<int>(i);
+        }
+
+        locations.resize(size);
+        desired_locations.resize(size);
+        statuses.resize(size, AgentStatus::not_started);
+        speeds.resize(size);
+        max_speeds.resize(size);
+        wiggles.resize(size);
+
+        cold_data.resize(size);
+        histories.resize(size);
+    }
+
+    void AgentStore::reset(unsigned long size) {
+        resize(size);
+        std::iota(ids.begin(), ids.end(), 0);
+        std::iota(slots.begin(), slots.end(), 0);
+        std::fill(statuses.begin(), statuses.end(), AgentStatus::not_started);
+
+        for (AgentColdData &agent_cold_data : cold_data) {
+            agent_cold_data.step_start = 0;
+            agent_cold_data.steps_taken = 0;
+            agent_cold_data.steps_delay = 0;
+        }
+        for (AgentHistory &history : histories) {
+            history.speeds.clear();
+            history.wiggles = 0;
+            history.collisions = 0;
+        }
+    }
+
+    unsigned long AgentStore::size() const { return locations.size(); }
+
+    // Copy everything but the histories, which are left empty
+    void AgentStore::assign_without_histories(const AgentStore &agent_store) {
+        ids = agent_store.ids;
+        slots = agent_store.slots;
+
+        locations = agent_store.locations;
+        desired_locations = agent_store.desired_locations;
+        statuses = agent_store.statuses;
+        speeds = agent_store.speeds;
+        max_speeds = agent_store.max_speeds;
+        wiggles = agent_store.wiggles;
+
+        cold_data = agent_store.cold_data;
+        histories.assign(agent_store.size(), AgentHistory());
+
+        float_distribution = agent_store.float_distribution;
+        gates_in_int_distribution = agent_store.gates_in_int_distribution;
+        gates_out_int_distribution = agent_store.gates_out_int_distribution;
+        gates_speed_exponential_distribution = agent_store.gates_speed_exponential_distribution;
+        speed_normal_distribution = agent_store.speed_normal_distribution;
+        wiggle_int_distribution = agent_store.wiggle_int_distribution;
+    }
+
+    void AgentStore::initialize_random_distributions(const ModelParameters &model_parameters) {
+        float_distribution = std::uniform_real_distribution<float>(-1, 1);
+        gates_in_int_distribution = std::uniform_int_distribution<int>(0, model_parameters.get_gates_in_count() - 1);
+        gates_out_int_distribution = std::uniform_int_distribution<int>(0, model_parameters.get_gates_out_count() - 1);
+        gates_speed_exponential_distribution = std::exponential_distribution<float>(model_parameters.get_gates_speed());
+        speed_normal_distribution =
+            std::normal_distribution<float>(model_parameters.get_speed_mean(), model_parameters.get_speed_std());
+        wiggle_int_distribution = std::uniform_int_distribution<int>(-1, 1);
+    }
+
+    bool AgentStore::sort_by_location(float cell_size) {
+        if (size() == 0) {
+            return false;
+        }
+
+        float min_x = locations[0].x;
+        float min_y = locations[0].y;
+        for (const Point2D &location : locations) {
+            min_x = std::fmin(min_x, location.x);
+            min_y = std::fmin(min_y, location.y);
+        }
+
+        // Locations further than 2^16 cells from the lowest one share the
+        // last row or column of the grid, invalid ones the first
+        auto cell = [&](float value, float min_value) {
+            float index = std::floor((value - min_value) / cell_size);
+            return static_cast<std::uint32_t>(std::fmin(std::fmax(index, 0.0f), 65535.0f));
+        };
+
+        std::vector<std::tuple<bool, std::uint32_t, int>> keys(size());
+        for (unsigned long i = 0; i < size(); i++) {
+            keys[i] = {statuses[i] != AgentStatus::active,
+                       morton_code(cell(locations[i].x, min_x), cell(locations[i].y, min_y)), ids[i]};
+        }
+
+        std::vector<int> order(size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return keys[a] < keys[b]; });
+        if (std::is_sorted(order.begin(), order.end())) {
+            return false;
+        }
+
+        permute(locations, order);
+        permute(desired_locations, order);
+        permute(statuses, order);
+        permute(speeds, order);
+        permute(max_speeds, order);
+        permute(wiggles, order);
+        permute(cold_data, order);
+        permute(histories, order);
+        permute(ids, order);
+        for (unsigned long i = 0; i < size(); i++) {
+            slots[static_cast<unsigned long>(ids[i])] = static_cast<int>(i);
+        }
+        return true;
+    }
+
+    // Interleave the bits of the 16-bit coordinates `x` and `y`
+    std::uint32_t AgentStore::morton_code(std::uint32_t x, std::uint32_t y) {
+        auto spread = [](std::uint32_t value) {
+            value &= 0x0000FFFF;
+            value = (value | (value << 8)) & 0x00FF00FF;
+            value = (value | (value << 4)) & 0x0F0F0F0F;
+            value = (value | (value << 2)) & 0x33333333;
+            value = (value | (value << 1)) & 0x55555555;
+            return value;
+        };
+        return spread(x) | (spread(y) << 1);
+    }
+
+    // Move the entry at slot `order[i]` to slot `i`
+    template <class T>
+    void AgentStore::permute(std::vector<T> &field, const std::vector<int> &order) {
+        std::vector<T> permuted;
+        permuted.reserve(field.size());
+        for (int slot : order) {
+            permuted.push_back(std::move(field[static_cast<unsigned long>(slot)]));
+        }
+        field.swap(permuted);
+    }
+} // namespace station_sim
@@ -0,0 +1,221 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "DomainDecomposition.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace station_sim {
+    DomainDecomposition::DomainDecomposition(MPI_Comm communicator, const std::vector<Point2D> &boundary_vertices,
+                                             float halo_width, unsigned long agents_number) {
+        if (boundary_vertices.empty()) {
+            throw std::invalid_argument("boundary_vertices must not be empty!");
+        }
+        if (halo_width <= 0) {
+            throw std::invalid_argument("halo_width must be positive!");
+        }
+
+        this->communicator = communicator;
+        MPI_Comm_rank(communicator, &rank);
+        MPI_Comm_size(communicator, &ranks_number);
+        this->halo_width = halo_width;
+
+        auto [min_vertex, max_vertex] = std::minmax_element(
+            boundary_vertices.begin(), boundary_vertices.end(),
+            [](const Point2D &a, const Point2D &b) { return a.x < b.x; });
+        float strip_width = (max_vertex->x - min_vertex->x) / static_cast<float>(ranks_number);
+        strip_starts.resize(static_cast<unsigned long>(ranks_number));
+        for (int r = 0; r < ranks_number; r++) {
+            strip_starts[r] = min_vertex->x + strip_width * static_cast<float>(r);
+        }
+
+        owned.assign(agents_number, 0);
+        outgoing_records.resize(static_cast<unsigned long>(ranks_number));
+    }
+
+    int DomainDecomposition::get_rank() const { return rank; }
+
+    int DomainDecomposition::get_ranks_number() const { return ranks_number; }
+
+    float DomainDecomposition::get_halo_width() const { return halo_width; }
+
+    int DomainDecomposition::strip_of(float x) const {
+        auto next_strip = std::upper_bound(strip_starts.begin() + 1, strip_starts.end(), x);
+        return static_cast<int>(next_strip - strip_starts.begin()) - 1;
+    }
+
+    bool DomainDecomposition::owns(int agent_id) const { return owned[agent_id] != 0; }
+
+    void DomainDecomposition::claim(const AgentStore &agent_store, const std::vector<int> &agent_ids) {
+        for (int agent_id : agent_ids) {
+            owned[agent_id] = strip_of(agent_store.locations[agent_store.slots[agent_id]].x) == rank;
+        }
+    }
+
+    void DomainDecomposition::exchange_halo(AgentStore &agent_store, const std::vector<int> &active_agents,
+                                            std::vector<int> &local_agents) {
+        // An agent is sent to every strip within `halo_width` of it, the
+        // strips are ordered along x
+        for (auto &records : outgoing_records) {
+            records.clear();
+        }
+        local_agents.clear();
+        for (int agent_id : active_agents) {
+            if (!owned[agent_id]) {
+                continue;
+            }
+            local_agents.push_back(agent_id);
+
+            int slot = agent_store.slots[agent_id];
+            const Point2D &location = agent_store.locations[slot];
+            int last_strip = strip_of(location.x + halo_width);
+            for (int strip = strip_of(location.x - halo_width); strip <= last_strip; strip++) {
+                if (strip != rank) {
+                    outgoing_records[strip].push_back(
+                        {agent_id, AgentStatus::active, location, agent_store.speeds[slot]});
+                }
+            }
+        }
+        exchange_records();
+
+        for (int agent_id : active_agents) {
+            if (!owned[agent_id]) {
+                agent_store.locations[agent_store.slots[agent_id]] =
+                    Point2D(std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::quiet_NaN());
+            }
+        }
+        for (const AgentRecord &record : received_records) {
+            int slot = agent_store.slots[record.agent_id];
+            agent_store.locations[slot] = record.location;
+            agent_store.speeds[slot] = record.speed;
+            local_agents.push_back(record.agent_id);
+        }
+        std::sort(local_agents.begin(), local_agents.end());
+    }
+
+    void DomainDecomposition::migrate(AgentStore &agent_store, const std::vector<int> &moved_agents,
+                                      std::vector<int> &remote_finished_agents) {
+        for (auto &records : outgoing_records) {
+            records.clear();
+        }
+        std::vector<AgentRecord> finished_records;
+        for (int agent_id : moved_agents) {
+            int slot = agent_store.slots[agent_id];
+            AgentRecord record{agent_id, agent_store.statuses[slot], agent_store.locations[slot],
+                               agent_store.speeds[slot]};
+            if (record.status == AgentStatus::finished) {
+                owned[agent_id] = 0;
+                finished_records.push_back(record);
+                continue;
+            }
+
+            int strip = strip_of(record.location.x);
+            if (strip != rank) {
+                owned[agent_id] = 0;
+                outgoing_records[strip].push_back(record);
+            }
+        }
+
+        exchange_records();
+        for (const AgentRecord &record : received_records) {
+            int slot = agent_store.slots[record.agent_id];
+            agent_store.locations[slot] = record.location;
+            agent_store.speeds[slot] = record.speed;
+            owned[record.agent_id] = 1;
+        }
+
+        all_gather_records(finished_records);
+        remote_finished_agents.clear();
+        for (const AgentRecord &record : received_records) {
+            int slot = agent_store.slots[record.agent_id];
+            agent_store.locations[slot] = record.location;
+            agent_store.speeds[slot] = record.speed;
+            agent_store.statuses[slot] = AgentStatus::finished;
+            remote_finished_agents.push_back(record.agent_id);
+        }
+    }
+
+    void DomainDecomposition::gather_locations(const AgentStore &agent_store, const std::vector<int> &active_agents,
+                                               std::vector<Point2D> &locations) const {
+        agent_store.by_id(agent_store.locations, locations);
+
+        std::vector<AgentRecord> owned_records;
+        for (int agent_id : active_agents) {
+            if (owned[agent_id]) {
+                int slot = agent_store.slots[agent_id];
+                owned_records.push_back(
+                    {agent_id, AgentStatus::active, agent_store.locations[slot], agent_store.speeds[slot]});
+            }
+        }
+
+        for (const AgentRecord &record : all_gather(owned_records)) {
+            locations[record.agent_id] = record.location;
+        }
+    }
+
+    std::vector<Point2D> DomainDecomposition::gather_points(const std::vector<Point2D> &points) const {
+        return all_gather(points);
+    }
+
+    void DomainDecomposition::exchange_records() {
+        send_records.clear();
+        std::vector<int> send_bytes(static_cast<unsigned long>(ranks_number));
+        std::vector<int> receive_bytes(static_cast<unsigned long>(ranks_number));
+        for (int r = 0; r < ranks_number; r++) {
+            send_records.insert(send_records.end(), outgoing_records[r].begin(), outgoing_records[r].end());
+            send_bytes[r] = static_cast<int>(outgoing_records[r].size() * sizeof(AgentRecord));
+        }
+        MPI_Alltoall(send_bytes.data(), 1, MPI_INT, receive_bytes.data(), 1, MPI_INT, communicator);
+
+        std::vector<int> send_displacements(static_cast<unsigned long>(ranks_number), 0);
+        std::vector<int> receive_displacements(static_cast<unsigned long>(ranks_number), 0);
+        std::partial_sum(send_bytes.begin(), send_bytes.end() - 1, send_displacements.begin() + 1);
+        std::partial_sum(receive_bytes.begin(), receive_bytes.end() - 1, receive_displacements.begin() + 1);
+
+        received_records.resize((receive_displacements.back() + receive_bytes.back()) / sizeof(AgentRecord));
+        MPI_Alltoallv(send_records.data(), send_bytes.data(), send_displacements.data(), MPI_BYTE,
+                      received_records.data(), receive_bytes.data(), receive_displacements.data(), MPI_BYTE,
+                      communicator);
+    }
+
+    // Send `records` to all the other ranks and receive theirs
+    void DomainDecomposition::all_gather_records(const std::vector<AgentRecord> &records) {
+        received_records.clear();
+        std::vector<AgentRecord> all_records = all_gather(records);
+        for (int r = 0, offset = 0; r < ranks_number; r++) {
+            auto first = all_records.begin() + offset;
+            offset += rank_sizes[r];
+            if (r != rank) {
+                received_records.insert(received_records.end(), first, all_records.begin() + offset);
+            }
+        }
+    }
+
+    // Concatenation, by rank, of the `values` of all the ranks. The number of
+    // values of each rank is left in `rank_sizes`.
+    template <class T>
+    std::vector<T> DomainDecomposition::all_gather(const std::vector<T> &values) const {
+        int size = static_cast<int>(values.size());
+        rank_sizes.resize(static_cast<unsigned long>(ranks_number));
+        MPI_Allgather(&size, 1, MPI_INT, rank_sizes.data(), 1, MPI_INT, communicator);
+
+        std::vector<int> receive_bytes(static_cast<unsigned long>(ranks_number));
+        std::vector<int> displacements(static_cast<unsigned long>(ranks_number), 0);
+        for (int r = 0; r < ranks_number; r++) {
+            receive_bytes[r] = rank_sizes[r] * static_cast<int>(sizeof(T));
+        }
+        std::partial_sum(receive_bytes.begin(), receive_bytes.end() - 1, displacements.begin() + 1);
+
+        std::vector<T> all_values((displacements.back() + receive_bytes.back()) / sizeof(T));
+        MPI_Allgatherv(values.data(), size * static_cast<int>(sizeof(T)), MPI_BYTE, all_values.data(),
+                       receive_bytes.data(), displacements.data(), MPI_BYTE, communicator);
+        return all_values;
+    }
+} // namespace station_sim
@@ -10,137 +10,527 @@
 #include "Agent.hpp"
 #include "HelpFunctions.hpp"
 #include "ModelParameters.hpp"
+#include "StepPolicy.hpp"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <iterator>
 #include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace station_sim {
     Model::~Model() = default;
 
-    Model::Model(int unique_id, ModelParameters model_parameters) {
-        this->model_parameters = model_parameters;
+    Model::Model(int unique_id, const ModelParameters &model_parameters)
+        : Model(unique_id, Scenario::create(model_parameters)) {}
+
+    Model::Model(int unique_id, std::shared_ptr<const Scenario> scenario) {
+        this->scenario = std::move(scenario);
+        const ModelParameters &model_parameters = this->scenario->get_model_parameters();
+        do_history = model_parameters.is_do_history();
+        do_print = model_parameters.is_do_print();
         initialize_model(unique_id);
         print_per_steps = 100;
 
-        history_state = std::vector<std::vector<Point2D>>(
-            model_parameters.get_step_limit(), std::vector<Point2D>(model_parameters.get_population_total()));
+        if (do_history) {
+            trajectory_recorder =
+                TrajectoryRecorder(agent_store.size(), model_parameters.get_history_stride(),
+                                   model_parameters.get_history_memory_limit());
+        }
     }
 
-    Model::Model(const Model &model) {
-        std::random_device rd;
-        std::array<int, std::mt19937::state_size> seed_data;
-        std::generate_n(seed_data.data(), seed_data.size(), std::ref(rd));
-        std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-        random_number_generator = std::make_shared<std::mt19937>(std::mt19937(seq));
+    Model::Model(const Model &model) : Particle<ModelState>(model) { *this = model; }
+
+    Model &Model::operator=(const Model &model) {
+        if (this == &model) {
+            return *this;
+        }
+
+        copy_simulation_state(model);
+
+        history_collision_locations = model.history_collision_locations;
+        history_wiggle_locations = model.history_wiggle_locations;
+        agent_store.histories = model.agent_store.histories;
+
+        steps_expected = model.steps_expected;
+        steps_taken = model.steps_taken;
+        steps_delay = model.steps_delay;
 
+        trajectory_recorder = model.trajectory_recorder;
+
+        return *this;
+    }
+
+    // Copy of the model which steps exactly as the model, but without its
+    // history, which the particle filter never reads. The copy does not record
+    // history either, so it keeps only the state of the simulation.
+    Model Model::clone_particle() const {
+        Model particle;
+        particle.copy_simulation_state(*this);
+        particle.do_history = false;
+        particle.select_step_kernel();
+        return particle;
+    }
+
+    void Model::reset(std::uint32_t random_seed) {
+        this->random_seed = random_seed;
+        status = ModelStatus::active;
+        perturbations_number = 0;
+        step_id = 0;
+        time = 0;
+        time_step = scenario->get_model_parameters().get_time_step();
+        pop_active = 0;
+        pop_finished = 0;
+        history_collisions_number = 0;
+        wiggle_collisions_number = 0;
+        history_collision_locations.clear();
+        history_wiggle_locations.clear();
+        steps_expected.clear();
+        steps_taken.clear();
+        steps_delay.clear();
+        domain_decomposition.reset();
+
+        agent_store.reset(static_cast<unsigned long>(scenario->get_population_total()));
+        generate_agents();
+        reset_free_flow();
+
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        trajectory_recorder.reset(agent_store.size(), model_parameters.get_history_stride(),
+                                  model_parameters.get_history_memory_limit());
+    }
+
+    // The station geometry and the neighbour search are kept if the new
+    // parameters do not change them
+    void Model::reset(const ModelParameters &model_parameters) {
+        const ModelParameters &previous_parameters = scenario->get_model_parameters();
+        bool same_neighbour_search =
+            model_parameters.get_neighbour_search_type() == previous_parameters.get_neighbour_search_type() &&
+            model_parameters.get_separation() == previous_parameters.get_separation() &&
+            model_parameters.get_verlet_skin() == previous_parameters.get_verlet_skin();
+
+        scenario = Scenario::create(model_parameters, *scenario);
+        do_history = model_parameters.is_do_history();
+        do_print = model_parameters.is_do_print();
+        if (!same_neighbour_search) {
+            create_neighbour_search();
+        }
+        select_step_kernel();
+        reset(static_cast<std::uint32_t>(model_parameters.get_random_seed()));
+    }
+
+    void Model::copy_simulation_state(const Model &model) {
         model_id = model.model_id;
         status = model.status;
-        speed_step = model.speed_step;
+        random_seed = model.random_seed;
+        perturbations_number = model.perturbations_number;
 
         history_collisions_number = model.history_collisions_number;
-        history_collision_locations = model.history_collision_locations;
         wiggle_collisions_number = model.wiggle_collisions_number;
-        history_wiggle_locations = model.history_wiggle_locations;
 
-        model_parameters = model.model_parameters;
+        scenario = model.scenario;
+        do_history = model.do_history;
+        do_print = model.do_print;
 
         step_id = model.step_id;
+        time = model.time;
+        time_step = model.time_step;
         pop_active = model.pop_active;
         pop_finished = model.pop_finished;
-        boundary_vertices = model.boundary_vertices;
-        gates_in = model.gates_in;
-        gates_out = model.gates_out;
+        agent_store.assign_without_histories(model.agent_store);
         agents = model.agents;
-        std::for_each(agents.begin(), agents.end(),
-                      [&](Agent &agent) { agent.set_random_number_generator(random_number_generator); });
-
-        steps_expected = model.steps_expected;
-        steps_taken = model.steps_taken;
-        steps_delay = model.steps_delay;
+        std::for_each(agents.begin(), agents.end(), [&](Agent &agent) { agent.set_agent_store(agent_store); });
+        activation_queue = model.activation_queue;
+        activation_queue_position = model.activation_queue_position;
+        active_agents = model.active_agents;
+        free_flow_until = model.free_flow_until;
+        free_flow_next_test = model.free_flow_next_test;
 
         print_per_steps = model.print_per_steps;
-        history_state = model.history_state;
+
+        neighbour_search = model.neighbour_search ? model.neighbour_search->clone() : nullptr;
+        domain_decomposition =
+            model.domain_decomposition ? std::make_unique<DomainDecomposition>(*model.domain_decomposition) : nullptr;
+        step_kernel = model.step_kernel;
     }
 
     void Model::initialize_model(int unique_id) {
-        std::random_device rd;
-        std::array<int, std::mt19937::state_size> seed_data;
-        std::generate_n(seed_data.data(), seed_data.size(), std::ref(rd));
-        std::seed_seq seq(std::begin(seed_data), std::end(seed_data));
-        random_number_generator = std::make_shared<std::mt19937>(std::mt19937(seq));
-
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
         model_id = unique_id;
         status = ModelStatus::active;
+        random_seed = static_cast<std::uint32_t>(model_parameters.get_random_seed());
+        perturbations_number = 0;
         step_id = 0;
+        time = 0;
+        time_step = model_parameters.get_time_step();
         pop_active = 0;
         pop_finished = 0;
         history_collisions_number = 0;
         wiggle_collisions_number = 0;
 
-        speed_step =
-            (model_parameters.get_speed_mean() - model_parameters.get_speed_min()) / model_parameters.get_speed_steps();
-
-        set_boundaries();
-        set_gates_in(model_parameters.get_gates_in());
-        set_gates_out(model_parameters.get_gates_out());
-
         generate_agents();
-    }
-
-    void Model::set_boundaries() {
-        boundary_vertices = model_parameters.get_boundaries();
-    }
+        reset_free_flow();
 
-    void Model::set_gates_in(std::vector<Gate> gates) {
-        gates_in = gates;
+        create_neighbour_search();
+        select_step_kernel();
     }
 
-    void Model::set_gates_out(std::vector<Gate> gates) {
-        gates_out = gates;
+    void Model::create_neighbour_search() {
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        neighbour_search =
+            NeighbourSearch::create(model_parameters.get_neighbour_search_type(), model_parameters.get_separation(),
+                                    model_parameters.get_verlet_skin());
     }
 
     void Model::generate_agents() {
-        if (model_parameters.get_agents_locations().size() > 0) {
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        const std::vector<Point2D> &agents_locations = scenario->get_agents_locations();
+        agent_store.resize(static_cast<unsigned long>(scenario->get_population_total()));
+        agent_store.initialize_random_distributions(model_parameters);
+        agents.clear();
+        agents.reserve(static_cast<unsigned long>(scenario->get_population_total()));
+
+        if (!agents_locations.empty()) {
             // If initial agents locations are set, use them...
-            for (int i = 0; i < model_parameters.get_population_total(); i++) {
-                agents.emplace_back(Agent(i, model_parameters.get_agents_locations().at(i), *this, model_parameters, random_number_generator));
+            for (int i = 0; i < scenario->get_population_total(); i++) {
+                agents.emplace_back(Agent(i, agents_locations[i], agent_store, *this, model_parameters));
             }
         } else {
             // ...otherwise call the `Agent` constructor which will generate
             // them randomly
-            for (int i = 0; i < model_parameters.get_population_total(); i++) {
-                agents.emplace_back(Agent(i, *this, model_parameters, random_number_generator));
+            for (int i = 0; i < scenario->get_population_total(); i++) {
+                agents.emplace_back(Agent(i, agent_store, *this, model_parameters));
             }
         }
+
+        initialize_agent_schedule();
     }
 
-    const std::vector<Gate> &Model::get_gates_in() const { return gates_in; }
+    // Queue the agents which have not started by activation step, and list
+    // the active ones by id
+    void Model::initialize_agent_schedule() {
+        activation_queue.clear();
+        active_agents.clear();
+        for (int i = 0; i < static_cast<int>(agent_store.size()); i++) {
+            if (agent_store.statuses[agent_store.slots[i]] == AgentStatus::not_started) {
+                activation_queue.push_back(i);
+            } else if (agent_store.statuses[agent_store.slots[i]] == AgentStatus::active) {
+                active_agents.push_back(i);
+            }
+        }
 
-    const std::vector<Gate> &Model::get_gates_out() const { return gates_out; }
+        std::stable_sort(activation_queue.begin(), activation_queue.end(), [&](int a, int b) {
+            return agent_store.cold_data[agent_store.slots[a]].steps_activate <
+                   agent_store.cold_data[agent_store.slots[b]].steps_activate;
+        });
+        activation_queue_position = 0;
+    }
 
-    void Model::step() {
-        if (pop_finished < model_parameters.get_population_total() && step_id < model_parameters.get_step_limit() &&
-            status == ModelStatus::active) {
-            if (model_parameters.is_do_print() && step_id % print_per_steps == 0) {
-                std::cout << "\tIteration: " << step_id << "/" << model_parameters.get_step_limit() << std::endl;
+    void Model::activate_due_agents() {
+        auto first_activated = static_cast<std::vector<int>::difference_type>(active_agents.size());
+        while (activation_queue_position < activation_queue.size()) {
+            int agent_id = activation_queue[activation_queue_position];
+            int slot = agent_store.slots[agent_id];
+            if (agent_store.cold_data[slot].steps_activate > time) {
+                break;
             }
+            activation_queue_position++;
 
-            // get agents and move them
-            move_agents();
+            if (agent_store.statuses[slot] == AgentStatus::not_started) {
+                agents[agent_id].activate_agent(*this);
+                active_agents.push_back(agent_id);
+            }
+        }
+
+        if (domain_decomposition) {
+            domain_decomposition->claim(
+                agent_store, std::vector<int>(active_agents.begin() + first_activated, active_agents.end()));
+        }
+
+        // Keep the active agents in id order, which is the order they move in
+        std::sort(active_agents.begin() + first_activated, active_agents.end());
+        std::inplace_merge(active_agents.begin(), active_agents.begin() + first_activated, active_agents.end());
+    }
+
+    void Model::remove_finished_agents() {
+        active_agents.erase(std::remove_if(active_agents.begin(), active_agents.end(),
+                                           [&](int agent_id) {
+                                               return agent_store.statuses[agent_store.slots[agent_id]] !=
+                                                      AgentStatus::active;
+                                           }),
+                            active_agents.end());
+    }
+
+    const std::vector<int> &Model::get_active_agents() const { return active_agents; }
+
+    // Every rank of `communicator` must build the same model and distribute
+    // it. The halo is as wide as the separation plus the distance an agent
+    // and its neighbour can move, including the clipping to the boundaries.
+    void Model::distribute(MPI_Comm communicator) {
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        if (model_parameters.get_agent_update_mode() != AgentUpdateMode::synchronous) {
+            throw std::invalid_argument("a distributed model needs the synchronous agent update!");
+        }
+        if (model_parameters.is_adaptive_time_step()) {
+            throw std::invalid_argument("a distributed model needs a fixed time step!");
+        }
 
-            if (model_parameters.is_do_history()) {
-                history_state[step_id] = get_agents_location();
+        float max_move = model_parameters.get_max_wiggle();
+        for (float max_speed : agent_store.max_speeds) {
+            max_move = std::fmax(max_move, max_speed);
+        }
+        max_move *= model_parameters.get_time_step();
+        float halo_width = (model_parameters.get_separation() + 2 * max_move) * 1.01f + 1.0e-3f;
+        domain_decomposition = std::make_unique<DomainDecomposition>(communicator, scenario->get_boundary_vertices(),
+                                                                     halo_width, agent_store.size());
+        domain_decomposition->claim(agent_store, active_agents);
+        reset_free_flow();
+    }
+
+    const DomainDecomposition *Model::get_domain_decomposition() const { return domain_decomposition.get(); }
+
+    // Slots in the store of the active agents, in id order, which are the
+    // agents indexed by the neighbour search
+    void Model::update_active_slots() {
+        active_slots.resize(active_agents.size());
+        std::transform(active_agents.begin(), active_agents.end(), active_slots.begin(),
+                       [&](int agent_id) { return agent_store.slots[agent_id]; });
+    }
+
+    // Give a window of `free_flow_steps` steps to the active agents which
+    // cannot come within the separation of another agent or an edge of the
+    // station in that time. A distributed model does not know all the agents
+    // around its strip, so it tests every move.
+    void Model::find_free_flow_agents() {
+        int steps = scenario->get_model_parameters().get_free_flow_steps();
+        if (steps == 0 || domain_decomposition || active_agents.empty()) {
+            return;
+        }
+
+        float max_speed = 0;
+        for (int slot : active_slots) {
+            max_speed = std::fmax(max_speed, agent_store.max_speeds[slot]);
+        }
+
+        for (int agent_id : active_agents) {
+            if (free_flow_until[agent_id] > step_id || free_flow_next_test[agent_id] > step_id) {
+                continue;
             }
 
-            step_id += 1;
+            if (can_free_flow(agent_id, steps, max_speed)) {
+                free_flow_until[agent_id] = step_id + steps;
+            } else {
+                // Crowded agents tend to stay crowded, so they are tested less
+                // often
+                free_flow_next_test[agent_id] = step_id + 4 * steps;
+            }
+        }
+    }
+
+    // An agent moves at most its maximum speed in a time unit, or twice that when
+    // it is moved back to the edges of the station, so whatever the other
+    // agents do it is enough to test the locations at the start of the
+    // window. The agents activated during the window are tested at their
+    // start location. The free flowing agent moves at its fastest speed,
+    // along a line up to rounding, which the slack covers.
+    bool Model::can_free_flow(int agent_id, int steps, float max_speed) {
+        int slot = agent_store.slots[agent_id];
+        const std::vector<float> &available_speeds = agent_store.cold_data[slot].available_speeds;
+        if (available_speeds.empty()) {
+            return false;
+        }
+
+        // The steps of the window are at most the time step of the parameters
+        const Point2D &location = agent_store.locations[slot];
+        float window = static_cast<float>(steps) * scenario->get_model_parameters().get_time_step();
+        float reach = window * available_speeds[0] * 1.001f + 1.0e-3f;
+        const StationGeometry &station_geometry = get_station_geometry();
+        if (station_geometry.is_outside(location) ||
+            station_geometry.closest_edge_point(location).distance(location) <= reach) {
+            return false;
+        }
+
+        float clearance = reach + scenario->get_model_parameters().get_separation() + 1.0e-3f;
+        auto is_far = [&](const Point2D &other_location, float other_max_speed) {
+            return location.distance(other_location) > clearance + 2 * window * other_max_speed * 1.001f;
+        };
+
+        float radius = clearance + 2 * window * max_speed * 1.001f;
+        neighbour_search->find_candidates(agent_store, slot, location, radius, free_flow_candidates);
+        for (int index : free_flow_candidates) {
+            if (!is_far(agent_store.locations[index], agent_store.max_speeds[index])) {
+                return false;
+            }
+        }
+
+        for (unsigned long i = activation_queue_position; i < activation_queue.size(); i++) {
+            int other_slot = agent_store.slots[activation_queue[i]];
+            const AgentColdData &cold_data = agent_store.cold_data[other_slot];
+            if (cold_data.steps_activate >= time + static_cast<double>(window)) {
+                break;
+            }
+            if (!is_far(cold_data.start_location, agent_store.max_speeds[other_slot])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Largest time step, between the minimum and the time step of the
+    // parameters, in which no two active agents can get within the separation
+    // of each other. Both can move up to twice their maximum speed per time
+    // unit, as in `can_free_flow`, so crowded stations take fine steps and
+    // sparse ones coarse steps.
+    float Model::choose_time_step() {
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        float max_time_step = model_parameters.get_time_step();
+        float max_speed = 0;
+        for (int slot : active_slots) {
+            max_speed = std::fmax(max_speed, agent_store.max_speeds[slot]);
+        }
+        if (max_speed == 0) {
+            return max_time_step;
+        }
+
+        float separation = model_parameters.get_separation();
+        float closing_speed = 4 * max_speed;
+        float min_gap = closing_speed * max_time_step;
+        for (int slot : active_slots) {
+            const Point2D &location = agent_store.locations[slot];
+            neighbour_search->find_candidates(agent_store, slot, location, separation + min_gap, time_step_candidates);
+            for (int index : time_step_candidates) {
+                min_gap = std::fmin(min_gap, location.distance(agent_store.locations[index]) - separation);
+            }
+        }
+        return std::clamp(min_gap / closing_speed, model_parameters.get_min_time_step(), max_time_step);
+    }
+
+    bool Model::is_free_flowing(int agent_id) const {
+        return static_cast<unsigned long>(agent_id) < free_flow_until.size() && free_flow_until[agent_id] > step_id;
+    }
+
+    // Called whenever the agents are moved outside of a step
+    void Model::reset_free_flow() {
+        free_flow_until.assign(agent_store.size(), 0);
+        free_flow_next_test.assign(agent_store.size(), 0);
+    }
+
+    // Sort the store along the Morton curve of the locations of the agents.
+    // The indices of the neighbour search are slots, so it is built again.
+    void Model::sort_agents() {
+        if (!agent_store.sort_by_location(scenario->get_model_parameters().get_separation())) {
+            return;
+        }
+
+        for (Agent &agent : agents) {
+            agent.set_store_slot(agent_store.slots[agent.get_agent_id()]);
+        }
+        create_neighbour_search();
+    }
+
+    const Scenario &Model::get_scenario() const { return *scenario; }
+
+    const std::vector<Point2D> &Model::get_boundary_vertices() const { return scenario->get_boundary_vertices(); }
+
+    const StationGeometry &Model::get_station_geometry() const { return scenario->get_station_geometry(); }
+
+    const std::vector<Gate> &Model::get_gates_in() const { return scenario->get_gates_in(); }
+
+    const std::vector<Gate> &Model::get_gates_out() const { return scenario->get_gates_out(); }
+
+    void Model::step() { (this->*step_kernel)(1); }
+
+    // Same as calling `step` `steps` times
+    void Model::advance(int steps) { (this->*step_kernel)(steps); }
+
+    // Pick the step kernel matching the parameters of the model. Called
+    // whenever the parameters are set, so `step` does not test them.
+    void Model::select_step_kernel() {
+        if (do_history) {
+            step_kernel = do_print ? select_step_kernel<true, true>() : select_step_kernel<true, false>();
         } else {
-            if (pop_finished < model_parameters.get_population_total()) {
-                status = ModelStatus::finished;
+            step_kernel = do_print ? select_step_kernel<false, true>() : select_step_kernel<false, false>();
+        }
+    }
+
+    template <bool DoHistory, bool DoPrint>
+    Model::StepKernel Model::select_step_kernel() const {
+        switch (scenario->get_model_parameters().get_neighbour_search_type()) {
+        case NeighbourSearchType::brute_force:
+            return &Model::step_with_policy<StepPolicy<DoHistory, DoPrint, BruteForceNeighbourSearch>>;
+        case NeighbourSearchType::sorted_sweep:
+            return &Model::step_with_policy<StepPolicy<DoHistory, DoPrint, SortedSweepNeighbourSearch>>;
+        case NeighbourSearchType::verlet_list:
+            return &Model::step_with_policy<StepPolicy<DoHistory, DoPrint, VerletListNeighbourSearch>>;
+        case NeighbourSearchType::uniform_grid:
+        default:
+            return &Model::step_with_policy<StepPolicy<DoHistory, DoPrint, UniformGridNeighbourSearch>>;
+        }
+    }
+
+    // Run `steps` steps, or until the model stops. What does not change
+    // between the steps is set up once.
+    template <class StepPolicy>
+    void Model::step_with_policy(int steps) {
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        int population_total = model_parameters.get_population_total();
+        int step_limit = model_parameters.get_step_limit();
+        int reorder_period = model_parameters.get_reorder_period();
+        bool adaptive_time_step = model_parameters.is_adaptive_time_step();
+        resize_thread_buffers();
+
+        for (int i = 0; i < steps; i++) {
+            if (pop_finished >= population_total || time >= step_limit || status != ModelStatus::active) {
+                if (pop_finished < population_total) {
+                    status = ModelStatus::finished;
+
+                    if (StepPolicy::do_print && status == ModelStatus::active) {
+                        std::cout << "StationSim " << model_id << " - Everyone made it!" << std::endl;
+                    }
+                }
+                return;
+            }
 
-                if (model_parameters.is_do_print() && status == ModelStatus::active) {
-                    std::cout << "StationSim " << model_id << " - Everyone made it!" << std::endl;
+            if constexpr (StepPolicy::do_print) {
+                if (step_id % print_per_steps == 0) {
+                    std::cout << "\tIteration: " << step_id << "/" << step_limit << std::endl;
                 }
             }
+
+            activate_due_agents();
+            if (reorder_period > 0 && step_id % reorder_period == 0) {
+                sort_agents();
+            }
+            update_active_slots();
+
+            // Agents can be moved between steps (e.g. by `set_state`), so the
+            // neighbour search index is rebuilt before moving them. A
+            // distributed model indexes only the agents around its strip.
+            if (!domain_decomposition) {
+                neighbour_search->rebuild(agent_store, active_slots);
+            }
+            if (adaptive_time_step) {
+                time_step = choose_time_step();
+            }
+            find_free_flow_agents();
+
+            // get agents and move them
+            move_agents<StepPolicy>();
+            remove_finished_agents();
+
+            if constexpr (StepPolicy::do_history) {
+                if (trajectory_recorder.is_recorded(step_id)) {
+                    get_agents_location(recorded_locations);
+                    trajectory_recorder.record(step_id, recorded_locations, time);
+                }
+            }
+
+            step_id += 1;
+            time += time_step;
         }
     }
 
@@ -167,26 +557,217 @@ namespace station_sim {
         history_wiggle_locations.push_back(new_location);
     }
 
+    const AgentStore &Model::get_agent_store() const { return agent_store; }
+
+    const TrajectoryRecorder &Model::get_trajectory_recorder() const { return trajectory_recorder; }
+
+    const NeighbourSearch &Model::get_neighbour_search() const { return *neighbour_search; }
+
+    void Model::update_agent_location_in_neighbour_search(int agent_id, const Point2D &old_location,
+                                                          const Point2D &new_location) {
+        neighbour_search->update(agent_id, old_location, new_location);
+    }
+
+    SpeedSolver &Model::get_speed_solver(int thread) { return speed_solvers.at(thread); }
+
+    AgentMoveHistory &Model::get_move_history(int thread) { return move_histories.at(thread); }
+
+    void Model::resize_thread_buffers() {
+        unsigned long threads_number = 1;
+#ifdef _OPENMP
+        threads_number = static_cast<unsigned long>(omp_get_max_threads());
+#endif
+        speed_solvers.resize(threads_number);
+        move_histories.resize(threads_number);
+        conflict_candidates.resize(threads_number);
+    }
+
+    // Append the collisions and wiggles of the step to the history of the
+    // model. With a static schedule each thread moves a contiguous range of
+    // agents, so the buffers are in agent order.
+    void Model::flush_move_histories() {
+        for (auto &move_history : move_histories) {
+            for (const auto &location : move_history.collision_locations) {
+                add_to_history_collision_locations(location);
+            }
+            for (const auto &location : move_history.wiggle_locations) {
+                add_to_history_wiggle_locations(location);
+            }
+            move_history.collision_locations.clear();
+            move_history.wiggle_locations.clear();
+        }
+    }
+
+    template <class StepPolicy>
     void Model::move_agents() {
-        for (auto &agent : agents) {
-            agent.step(*this, model_parameters);
+        const ModelParameters &model_parameters = scenario->get_model_parameters();
+        if (domain_decomposition) {
+            move_agents_distributed<StepPolicy>();
+        } else if (model_parameters.get_agent_update_mode() == AgentUpdateMode::synchronous) {
+            move_agents_synchronously<StepPolicy>();
+        } else {
+            for (int agent_id : active_agents) {
+                agents[agent_id].step<StepPolicy>(*this, model_parameters);
+            }
         }
+
+        flush_move_histories();
     }
 
-    int Model::get_unique_id() const { return model_id; }
+    // Move all the agents from the locations they had at the start of the
+    // step. The moves are proposed in parallel, then committed together; a
+    // move conflicting with the move of an agent with a lower id is undone,
+    // and that agent stays where it was. Everything which depends on the order
+    // of the agents is done serially, so the results do not depend on the
+    // number of threads.
+    template <class StepPolicy>
+    void Model::move_agents_synchronously() {
+        propose_moves<StepPolicy>(active_agents);
+        commit_moves(active_agents);
+        neighbour_search->rebuild(agent_store, active_slots);
+        resolve_move_conflicts<StepPolicy>(active_agents);
+    }
+
+    // Same as `move_agents_synchronously`, but each rank moves the agents in
+    // its strip of the station. The agents of the other strips which can
+    // block them are received before proposing the moves, and again before
+    // looking for conflicts, so the moves are the same as in a single model.
+    template <class StepPolicy>
+    void Model::move_agents_distributed() {
+        DomainDecomposition &domain = *domain_decomposition;
+        owned_agents.clear();
+        std::copy_if(active_agents.begin(), active_agents.end(), std::back_inserter(owned_agents),
+                     [&](int agent_id) { return domain.owns(agent_id); });
+
+        domain.exchange_halo(agent_store, active_agents, local_agents);
+        index_local_agents();
+        propose_moves<StepPolicy>(owned_agents);
+        commit_moves(owned_agents);
+
+        domain.exchange_halo(agent_store, active_agents, local_agents);
+        index_local_agents();
+        resolve_move_conflicts<StepPolicy>(owned_agents);
+
+        domain.migrate(agent_store, owned_agents, remote_finished_agents);
+        pop_active -= static_cast<int>(remote_finished_agents.size());
+        pop_finished += static_cast<int>(remote_finished_agents.size());
+    }
 
-    float Model::get_speed_step() const { return speed_step; }
+    void Model::index_local_agents() {
+        local_slots.resize(local_agents.size());
+        std::transform(local_agents.begin(), local_agents.end(), local_slots.begin(),
+                       [&](int agent_id) { return agent_store.slots[agent_id]; });
+        neighbour_search->rebuild(agent_store, local_slots);
+    }
+
+    template <class StepPolicy>
+    void Model::propose_moves(const std::vector<int> &agent_ids) {
+        proposed_moves.resize(agent_store.size());
+        int agents_number = static_cast<int>(agent_ids.size());
+
+#pragma omp parallel default(none) shared(agent_ids, agents_number)
+        {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+#pragma omp for schedule(static)
+            for (int i = 0; i < agents_number; i++) {
+                int agent_id = agent_ids[i];
+                proposed_moves[agent_id] =
+                    agents[agent_id].propose_move<StepPolicy>(*this, speed_solvers[thread], move_histories[thread]);
+            }
+        }
+    }
 
-    std::shared_ptr<std::mt19937> Model::get_generator() const { return random_number_generator; }
+    void Model::commit_moves(const std::vector<int> &agent_ids) {
+        previous_locations.resize(agent_store.size());
+        for (int agent_id : agent_ids) {
+            int slot = agent_store.slots[agent_id];
+            previous_locations[slot] = agent_store.locations[slot];
+            agent_store.locations[slot] = proposed_moves[agent_id].location;
+            agent_store.speeds[slot] = proposed_moves[agent_id].speed;
+        }
+    }
 
-    std::vector<Point2D> Model::get_agents_location() {
-        std::vector<Point2D> agents_locations;
+    template <class StepPolicy>
+    void Model::resolve_move_conflicts(const std::vector<int> &agent_ids) {
+        int agents_number = static_cast<int>(agent_ids.size());
+        conflicting_moves.assign(agent_store.size(), 0);
+#pragma omp parallel default(none) shared(agent_ids, agents_number)
+        {
+            int thread = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+#endif
+#pragma omp for schedule(static)
+            for (int i = 0; i < agents_number; i++) {
+                int agent_id = agent_ids[i];
+                conflicting_moves[agent_id] =
+                    !is_free_flowing(agent_id) && has_move_conflict<StepPolicy>(agent_id, conflict_candidates[thread]);
+            }
+        }
 
-        for (const Agent &agent : agents) {
-            agents_locations.push_back(agent.get_agent_location());
+        for (int agent_id : agent_ids) {
+            if (conflicting_moves[agent_id]) {
+                int slot = agent_store.slots[agent_id];
+                neighbour_search->update(slot, agent_store.locations[slot], previous_locations[slot]);
+                agent_store.locations[slot] = previous_locations[slot];
+                agent_store.speeds[slot] = 0;
+            }
+            agents[agent_id].deactivate_agent_if_reached_exit_gate<StepPolicy>(*this,
+                                                                                scenario->get_model_parameters());
         }
+    }
+
+    // True if the move of `agent_id` collides, in either direction, with the
+    // move of an agent with a lower id
+    template <class StepPolicy>
+    bool Model::has_move_conflict(int agent_id, std::vector<int> &candidates) const {
+        const auto &search = static_cast<const typename StepPolicy::neighbour_search_backend &>(*neighbour_search);
+        int slot = agent_store.slots[agent_id];
+        const Point2D &location = agent_store.locations[slot];
+        search.find_candidates(agent_store, slot, location, search.search_radius(), candidates);
+        return std::any_of(candidates.begin(), candidates.end(), [&](int index) {
+            return agent_store.ids[index] < agent_id &&
+                   (search.is_blocking(agent_store, index, slot, location) ||
+                    search.is_blocking(agent_store, slot, index, agent_store.locations[index]));
+        });
+    }
+
+    int Model::get_unique_id() const { return model_id; }
 
-        return agents_locations;
+    float Model::get_speed_step() const { return scenario->get_speed_step(); }
+
+    double Model::get_time() const { return time; }
+
+    float Model::get_time_step() const { return time_step; }
+
+    CounterRandomEngine Model::get_random_engine(RandomStream stream, int agent_id) const {
+        return CounterRandomEngine(random_seed, static_cast<std::uint32_t>(stream), static_cast<std::uint32_t>(model_id),
+                                   static_cast<std::uint32_t>(agent_id), static_cast<std::uint32_t>(step_id));
+    }
+
+    // The direction depends only on the agent and the step, so it is the same
+    // whichever order, thread or update mode the agents are moved in
+    int Model::draw_wiggle_direction(int agent_id) const {
+        CounterRandomEngine random_engine = get_random_engine(RandomStream::agent_move, agent_id);
+        std::uniform_int_distribution<int> wiggle_distribution = agent_store.wiggle_int_distribution;
+        return wiggle_distribution(random_engine);
+    }
+
+    std::vector<Point2D> Model::get_agents_location() const {
+        std::vector<Point2D> locations;
+        get_agents_location(locations);
+        return locations;
+    }
+
+    void Model::get_agents_location(std::vector<Point2D> &locations) const {
+        if (domain_decomposition) {
+            domain_decomposition->gather_locations(agent_store, active_agents, locations);
+        } else {
+            agent_store.by_id(agent_store.locations, locations);
+        }
     }
 
     void Model::calculate_print_model_run_analytics() {
@@ -201,31 +782,47 @@ namespace station_sim {
                   << std::reduce(steps_delay.begin(), steps_delay.end(), 0.0) / agents.size() << std::endl;
         std::cout << "Mean number of collisions per agent: "
                   << std::accumulate(
-                         agents.begin(), agents.end(), 0.0,
-                         [&](int total, const Agent &agent) { return total += agent.get_history_collisions(); }) /
+                         agent_store.histories.begin(), agent_store.histories.end(), 0.0,
+                         [&](int total, const AgentHistory &history) { return total += history.collisions; }) /
                          agents.size()
                   << std::endl;
         std::cout << "Mean number of wiggles per agent: "
                   << std::accumulate(
-                         agents.begin(), agents.end(), 0.0,
-                         [&](int total, const Agent &agent) { return total += agent.get_history_wiggles(); }) /
+                         agent_store.histories.begin(), agent_store.histories.end(), 0.0,
+                         [&](int total, const AgentHistory &history) { return total += history.wiggles; }) /
                          agents.size()
                   << std::endl;
     }
 
-    ModelParameters Model::get_model_parameters() const { return model_parameters; }
+    const ModelParameters &Model::get_model_parameters() const { return scenario->get_model_parameters(); }
+
+    bool Model::is_do_history() const { return do_history; }
 
-    bool Model::model_simulation_finished() { return pop_finished == model_parameters.get_population_total(); }
+    bool Model::model_simulation_finished() { return pop_finished == scenario->get_population_total(); }
 
     void Model::write_model_output_to_hdf_5(std::string file_name) {
+        // The collisions and wiggles of a distributed model are recorded by
+        // the ranks moving the agents, and all written by the first rank
+        std::vector<Point2D> gathered_collision_locations;
+        std::vector<Point2D> gathered_wiggle_locations;
+        if (domain_decomposition) {
+            gathered_collision_locations = domain_decomposition->gather_points(history_collision_locations);
+            gathered_wiggle_locations = domain_decomposition->gather_points(history_wiggle_locations);
+            if (domain_decomposition->get_rank() != 0) {
+                return;
+            }
+        }
+
         // Create a file
         H5::H5File file(file_name.c_str(), H5F_ACC_TRUNC);
         H5::Group history_group(file.createGroup("/history"));
 
         // write_model_parameters_to_hdf5(file);
         write_agent_locations_to_hdf_5(history_group);
-        write_collisions_history_to_hdf_5(history_group);
-        write_wiggle_history_to_hdf_5(history_group);
+        write_collisions_history_to_hdf_5(
+            history_group, domain_decomposition ? gathered_collision_locations : history_collision_locations);
+        write_wiggle_history_to_hdf_5(history_group,
+                                      domain_decomposition ? gathered_wiggle_locations : history_wiggle_locations);
     }
 
     // todo
@@ -235,9 +832,11 @@ namespace station_sim {
         H5::Group agents_locations_group(history_group.createGroup("/history/agents_locations"));
 
         for (Agent &agent : agents) {
+            std::vector<Point2D> history_locations = trajectory_recorder.get_agent_trajectory(agent.get_agent_id());
+
             // Create the data space for the dataset.
             hsize_t dims[2];
-            dims[0] = agent.get_history_locations().size();
+            dims[0] = history_locations.size();
             dims[1] = 2;
             int rank = 2;
             H5::DataSpace dataspace(rank, dims);
@@ -247,31 +846,32 @@ namespace station_sim {
             H5::DataSet dataset =
                 agents_locations_group.createDataSet(dataset_name.c_str(), H5::PredType::NATIVE_FLOAT, dataspace);
 
-            float agents_locations[dims[0]][2];
-            for (int i = 0; i < dims[0]; i++) {
-                agents_locations[i][0] = agent.get_history_locations()[i].x;
-                agents_locations[i][1] = agent.get_history_locations()[i].y;
+            std::vector<float> agents_locations(2 * dims[0]);
+            for (hsize_t i = 0; i < dims[0]; i++) {
+                agents_locations[2 * i] = history_locations[i].x;
+                agents_locations[2 * i + 1] = history_locations[i].y;
             }
-            dataset.write(agents_locations, H5::PredType::NATIVE_FLOAT);
+            dataset.write(agents_locations.data(), H5::PredType::NATIVE_FLOAT);
         }
     }
 
-    void Model::write_collisions_history_to_hdf_5(H5::Group &history_group) {
+    void Model::write_collisions_history_to_hdf_5(H5::Group &history_group,
+                                                  const std::vector<Point2D> &locations) {
         int rank = 2;
         hsize_t dims[2];
-        dims[0] = history_collision_locations.size();
+        dims[0] = locations.size();
         dims[1] = 2;
         H5::DataSpace dataspace(rank, dims);
 
         H5::DataSet dataset =
             history_group.createDataSet("collisions_locations", H5::PredType::NATIVE_FLOAT, dataspace);
 
-        int temp_size = history_collision_locations.size();
+        int temp_size = locations.size();
         std::vector<std::vector<float>> collision_locations(temp_size, std::vector<float>(2));
-        for (int i = 0; i < history_collision_locations.size(); i++) {
+        for (int i = 0; i < locations.size(); i++) {
 
-            collision_locations[i][0] = history_collision_locations[i].x;
-            collision_locations[i][1] = history_collision_locations[i].y;
+            collision_locations[i][0] = locations[i].x;
+            collision_locations[i][1] = locations[i].y;
         }
         dataset.write(collision_locations.data(), H5::PredType::NATIVE_FLOAT);
 
@@ -282,20 +882,20 @@ namespace station_sim {
         myatt_in.write(strdatatype, strwritebuf);
     }
 
-    void Model::write_wiggle_history_to_hdf_5(H5::Group &history_group) {
+    void Model::write_wiggle_history_to_hdf_5(H5::Group &history_group, const std::vector<Point2D> &locations) {
         int rank = 2;
         hsize_t dims[2];
-        dims[0] = history_wiggle_locations.size();
+        dims[0] = locations.size();
         dims[1] = 2;
         H5::DataSpace dataspace(rank, dims);
 
         H5::DataSet dataset = history_group.createDataSet("wiggle_locations", H5::PredType::NATIVE_FLOAT, dataspace);
 
-        float collision_locations[history_wiggle_locations.size()][2];
-        for (int i = 0; i < history_wiggle_locations.size(); i++) {
+        float collision_locations[locations.size()][2];
+        for (int i = 0; i < locations.size(); i++) {
 
-            collision_locations[i][0] = history_wiggle_locations[i].x;
-            collision_locations[i][1] = history_wiggle_locations[i].y;
+            collision_locations[i][0] = locations[i].x;
+            collision_locations[i][1] = locations[i].y;
         }
         dataset.write(collision_locations, H5::PredType::NATIVE_FLOAT);
 
@@ -308,37 +908,44 @@ namespace station_sim {
 
     ModelStatus Model::get_status() const { return status; }
 
-    void Model::reseed_random_number_generator() {
-        std::random_device r;
-        random_number_generator = std::make_shared<std::mt19937>(std::mt19937(r()));
-    }
+    std::uint32_t Model::get_random_seed() const { return random_seed; }
+
+    void Model::reseed_random_number_generator() { random_seed = CounterRandomEngine::random_seed(); }
 
-    const ModelState Model::get_state() const {
+    ModelState Model::get_state() const {
         ModelState model_state;
 
-        for (const Agent &agent : agents) {
-            model_state.agents_location.push_back(agent.get_agent_location());
-            model_state.agent_active_status.push_back(agent.getStatus());
-            model_state.agents_desired_location.push_back(agent.get_desired_location());
-        }
+        model_state.agents_location = get_agents_location();
+        model_state.agent_active_status = agent_store.by_id(agent_store.statuses);
+        model_state.agents_desired_location = agent_store.by_id(agent_store.desired_locations);
 
         return model_state;
     }
 
+    ModelStateView Model::get_state_view() const { return ModelStateView(agent_store); }
+
     void Model::set_state(const ModelState &new_state) {
         for (unsigned long i = 0; i < new_state.agents_location.size(); i++) {
-            agents.at(i).set_agent_location(new_state.agents_location.at(i));
-            agents.at(i).set_desired_location(new_state.agents_desired_location.at(i));
+            unsigned long slot = static_cast<unsigned long>(agent_store.slots.at(i));
+            agent_store.locations.at(slot) = new_state.agents_location.at(i);
+            agent_store.desired_locations.at(slot) = new_state.agents_desired_location.at(i);
+        }
+
+        if (domain_decomposition) {
+            domain_decomposition->claim(agent_store, active_agents);
         }
+        reset_free_flow();
     }
 
     std::vector<float> Model::get_active_agents_state() const {
+        std::vector<Point2D> locations = domain_decomposition ? get_agents_location() : std::vector<Point2D>();
         std::vector<float> state;
-        for (const Agent &agent : agents) {
-            if (agent.getStatus() == AgentStatus::active) {
-                state.push_back(agent.get_agent_location().x);
-                state.push_back(agent.get_agent_location().y);
-            }
+        state.reserve(2 * active_agents.size());
+        for (int agent_id : active_agents) {
+            const Point2D &location =
+                domain_decomposition ? locations[agent_id] : agent_store.locations[agent_store.slots[agent_id]];
+            state.push_back(location.x);
+            state.push_back(location.y);
         }
         return state;
     }
@@ -346,13 +953,18 @@ namespace station_sim {
     bool Model::is_active() const { return get_status() == ModelStatus::active; }
 
     void Model::perturb_state(float standard_deviation) {
+        CounterRandomEngine random_engine(random_seed, static_cast<std::uint32_t>(RandomStream::state_perturbation),
+                                          static_cast<std::uint32_t>(model_id),
+                                          static_cast<std::uint32_t>(perturbations_number));
+        perturbations_number++;
         std::normal_distribution<float> dis(0.0, standard_deviation);
 
-        for (Agent &agent : agents) {
-            Point2D agent_location = agent.get_agent_location();
-            agent_location.x += dis(*random_number_generator);
-            agent_location.y += dis(*random_number_generator);
-            agent.set_agent_location(agent_location);
+        // In id order, so that the draws do not depend on the order of the store
+        for (int slot : agent_store.slots) {
+            Point2D &agent_location = agent_store.locations[slot];
+            agent_location.x += dis(random_engine);
+            agent_location.y += dis(random_engine);
         }
+        reset_free_flow();
     }
 } // namespace station_sim
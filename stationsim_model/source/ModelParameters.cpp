@@ -21,6 +21,9 @@ namespace station_sim {
         // Some random default values for boundaries and gates, the user will
         // need to take care of setting something sensible in their application
         this->boundary_vertices = { {Point2D(0, 0), Point2D(0, 100), Point2D(200, 100), Point2D(200, 0)} };
+        this->obstacles = {};
+        // No raster of the station by default
+        this->raster_cell_size = 0;
         this->gates_in = { {
                 Gate(Point2D(0, 25)),
                 Gate(Point2D(0, 50)),
@@ -40,10 +43,20 @@ namespace station_sim {
 
         this->separation = 2;
         this->max_wiggle = 1;
+        this->neighbour_search_type = NeighbourSearchType::uniform_grid;
+        this->verlet_skin = 4;
+        this->reorder_period = 0;
+        this->free_flow_steps = 0;
+        this->agent_update_mode = AgentUpdateMode::sequential;
 
         this->step_limit = 3600;
+        this->time_step = 1;
+        this->adaptive_time_step = false;
+        this->min_time_step = static_cast<float>(0.25);
 
         this->do_history = true;
+        this->history_stride = 1;
+        this->history_memory_limit = 0;
         this->do_print = true;
 
         std::random_device r;
@@ -66,7 +79,7 @@ namespace station_sim {
         this->population_total = value;
     }
 
-    std::vector<Point2D> ModelParameters::get_agents_locations() const { return agents_locations; }
+    const std::vector<Point2D> &ModelParameters::get_agents_locations() const { return agents_locations; }
 
     void ModelParameters::set_agents_locations(std::vector<Point2D> locations) {
         // Set the agents locations and update the population size, for consistency.
@@ -74,13 +87,29 @@ namespace station_sim {
         this->population_total = locations.size();
     }
 
-    std::vector<Point2D> ModelParameters::get_boundaries() const { return boundary_vertices; };
+    const std::vector<Point2D> &ModelParameters::get_boundaries() const { return boundary_vertices; }
 
     void ModelParameters::set_boundaries(std::vector<Point2D> boundary_vertices) {
         this->boundary_vertices = boundary_vertices;
     }
 
-    std::vector<Gate> ModelParameters::get_gates_in() const { return gates_in; }
+    const std::vector<std::vector<Point2D>> &ModelParameters::get_obstacles() const { return obstacles; }
+
+    void ModelParameters::set_obstacles(std::vector<std::vector<Point2D>> obstacles) {
+        this->obstacles = obstacles;
+    }
+
+    float ModelParameters::get_raster_cell_size() const { return raster_cell_size; }
+
+    void ModelParameters::set_raster_cell_size(float value) {
+        if (value < 0) {
+            throw std::invalid_argument("raster_cell_size must not be negative!");
+        }
+
+        this->raster_cell_size = value;
+    }
+
+    const std::vector<Gate> &ModelParameters::get_gates_in() const { return gates_in; }
 
     int ModelParameters::get_gates_in_count() const { return gates_in.size(); }
 
@@ -88,7 +117,7 @@ namespace station_sim {
         this->gates_in = gates;
     }
 
-    std::vector<Gate> ModelParameters::get_gates_out() const { return gates_out; }
+    const std::vector<Gate> &ModelParameters::get_gates_out() const { return gates_out; }
 
     int ModelParameters::get_gates_out_count() const { return gates_out.size(); }
 
@@ -176,6 +205,50 @@ namespace station_sim {
         this->max_wiggle = value;
     }
 
+    NeighbourSearchType ModelParameters::get_neighbour_search_type() const { return neighbour_search_type; }
+
+    void ModelParameters::set_neighbour_search_type(NeighbourSearchType value) { this->neighbour_search_type = value; }
+
+    float ModelParameters::get_verlet_skin() const { return verlet_skin; }
+
+    void ModelParameters::set_verlet_skin(float value) {
+        if (value <= 0) {
+            throw std::invalid_argument("verlet_skin must be positive!");
+        }
+
+        this->verlet_skin = value;
+    }
+
+    int ModelParameters::get_reorder_period() const { return reorder_period; }
+
+    // Sort the agents of the model by location every `value` steps, or
+    // never if `value` is 0
+    void ModelParameters::set_reorder_period(int value) {
+        if (value < 0) {
+            throw std::invalid_argument("reorder_period must not be negative!");
+        }
+
+        this->reorder_period = value;
+    }
+
+    int ModelParameters::get_free_flow_steps() const { return free_flow_steps; }
+
+    // Move the agents which cannot meet another agent or an edge of the
+    // station in the next `value` steps without testing for collisions, or
+    // test every agent on every step if `value` is 0. The moves are the same
+    // either way.
+    void ModelParameters::set_free_flow_steps(int value) {
+        if (value < 0) {
+            throw std::invalid_argument("free_flow_steps must not be negative!");
+        }
+
+        this->free_flow_steps = value;
+    }
+
+    AgentUpdateMode ModelParameters::get_agent_update_mode() const { return agent_update_mode; }
+
+    void ModelParameters::set_agent_update_mode(AgentUpdateMode value) { this->agent_update_mode = value; }
+
     int ModelParameters::get_step_limit() const { return step_limit; }
 
     void ModelParameters::set_step_limit(int value) {
@@ -186,10 +259,54 @@ namespace station_sim {
         this->step_limit = value;
     }
 
+    float ModelParameters::get_time_step() const { return time_step; }
+
+    // Time units per step. The speeds, the wiggles and the activation steps
+    // of the agents, and the step limit, are in time units, so a larger time
+    // step runs the same scenario in fewer, coarser, steps.
+    void ModelParameters::set_time_step(float value) {
+        if (value <= 0) {
+            throw std::invalid_argument("time_step must be positive!");
+        }
+
+        this->time_step = value;
+    }
+
+    bool ModelParameters::is_adaptive_time_step() const { return adaptive_time_step; }
+
+    // Choose the time step of every step between `min_time_step` and
+    // `time_step`, the largest in which no two active agents can get within
+    // the separation of each other
+    void ModelParameters::set_adaptive_time_step(bool value) { this->adaptive_time_step = value; }
+
+    float ModelParameters::get_min_time_step() const { return min_time_step; }
+
+    void ModelParameters::set_min_time_step(float value) {
+        if (value <= 0) {
+            throw std::invalid_argument("min_time_step must be positive!");
+        }
+
+        this->min_time_step = value;
+    }
+
     bool ModelParameters::is_do_history() const { return do_history; }
 
     void ModelParameters::set_do_history(bool value) { this->do_history = value; }
 
+    int ModelParameters::get_history_stride() const { return history_stride; }
+
+    void ModelParameters::set_history_stride(int value) {
+        if (value <= 0) {
+            throw std::invalid_argument("history_stride must be positive!");
+        }
+
+        this->history_stride = value;
+    }
+
+    unsigned long ModelParameters::get_history_memory_limit() const { return history_memory_limit; }
+
+    void ModelParameters::set_history_memory_limit(unsigned long value) { this->history_memory_limit = value; }
+
     bool ModelParameters::is_do_print() const { return do_print; }
 
     void ModelParameters::set_do_print(bool value) { this->do_print = value; }
@@ -38,7 +38,7 @@ namespace station_sim {
         float x_max=std::numeric_limits<float>::min();
         float y_min=std::numeric_limits<float>::max();
         float y_max=std::numeric_limits<float>::min();
-        for (const Point2D& vertex: model.boundary_vertices){
+        for (const Point2D& vertex: model.get_boundary_vertices()){
             x_min = std::min(vertex.x, x_min);
             x_max = std::max(vertex.x, x_max);
             y_min = std::min(vertex.y, y_min);
@@ -84,7 +84,8 @@ namespace station_sim {
             std::vector<float> agent_location_history_x;
             std::vector<float> agent_location_history_y;
 
-            for (const Point2D &point_2_d : agent.get_history_locations()) {
+            for (const Point2D &point_2_d :
+                 model.get_trajectory_recorder().get_agent_trajectory(agent.get_agent_id())) {
                 agent_location_history_x.push_back(point_2_d.x);
                 agent_location_history_y.push_back(point_2_d.y);
             }
@@ -21,8 +21,11 @@ namespace station_sim {
     }
 
     void MultipleModelsRun::run_model(int model_index) {
-        for (int i = 0; i < models[model_index].get_model_parameters().get_step_limit(); i++) {
-            models[model_index].step();
+        // The step limit is in time units, so a model can need more steps
+        // than that
+        Model &model = models[model_index];
+        while (model.is_active() && !model.model_simulation_finished()) {
+            model.advance(model.get_model_parameters().get_step_limit());
         }
     }
 
@@ -0,0 +1,469 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "NeighbourSearch.hpp"
+#include "AgentStore.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace station_sim {
+    NeighbourSearch::NeighbourSearch(float separation) { this->separation = separation; }
+
+    std::unique_ptr<NeighbourSearch> NeighbourSearch::create(NeighbourSearchType type, float separation,
+                                                             float verlet_skin) {
+        switch (type) {
+        case NeighbourSearchType::brute_force:
+            return std::make_unique<BruteForceNeighbourSearch>(separation);
+        case NeighbourSearchType::uniform_grid:
+            return std::make_unique<UniformGridNeighbourSearch>(separation);
+        case NeighbourSearchType::sorted_sweep:
+            return std::make_unique<SortedSweepNeighbourSearch>(separation);
+        case NeighbourSearchType::verlet_list:
+            return std::make_unique<VerletListNeighbourSearch>(separation, verlet_skin);
+        }
+        throw std::invalid_argument("unknown neighbour search type!");
+    }
+
+    float NeighbourSearch::get_separation() const { return separation; }
+
+    void NeighbourSearch::rebuild(const AgentStore &agent_store) {
+        std::vector<int> agent_indices(agent_store.size());
+        for (unsigned long i = 0; i < agent_indices.size(); i++) {
+            agent_indices[i] = static_cast<int>(i);
+        }
+        rebuild(agent_store, agent_indices);
+    }
+
+    bool NeighbourSearch::is_blocking(const AgentStore &agent_store, int index, int agent_id,
+                                      const Point2D &location) const {
+        return index != agent_id && agent_store.statuses[index] == AgentStatus::active &&
+               location.distance(agent_store.locations[index]) <= separation &&
+               location.x <= agent_store.locations[index].x;
+    }
+
+    bool NeighbourSearch::is_candidate(const AgentStore &agent_store, int index, int agent_id,
+                                       const Point2D &location, double radius) const {
+        if (index == agent_id || agent_store.statuses[index] != AgentStatus::active) {
+            return false;
+        }
+        double dx = static_cast<double>(agent_store.locations[index].x) - static_cast<double>(location.x);
+        double dy = static_cast<double>(agent_store.locations[index].y) - static_cast<double>(location.y);
+        return dx * dx + dy * dy <= radius * radius;
+    }
+
+    // The distance between two agents is computed in single precision, so an
+    // agent found at `separation` can be marginally further away than that.
+    // The spatial backends widen their search by a tiny relative amount to
+    // never miss such an agent; the exact test is done by `is_blocking`.
+    double NeighbourSearch::search_radius() const { return static_cast<double>(separation) * (1.0 + 1.0e-6); }
+
+    BruteForceNeighbourSearch::BruteForceNeighbourSearch(float separation) : NeighbourSearch(separation) {}
+
+    std::unique_ptr<NeighbourSearch> BruteForceNeighbourSearch::clone() const {
+        return std::make_unique<BruteForceNeighbourSearch>(*this);
+    }
+
+    void BruteForceNeighbourSearch::rebuild(const AgentStore &, const std::vector<int> &) {}
+
+    void BruteForceNeighbourSearch::update(int, const Point2D &, const Point2D &) {}
+
+    bool BruteForceNeighbourSearch::collides(const AgentStore &agent_store, int agent_id,
+                                             const Point2D &location) const {
+        int size = static_cast<int>(agent_store.size());
+        for (int index = 0; index < size; index++) {
+            if (is_blocking(agent_store, index, agent_id, location)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void BruteForceNeighbourSearch::find_candidates(const AgentStore &agent_store, int agent_id,
+                                                    const Point2D &location, double radius,
+                                                    std::vector<int> &candidates) const {
+        candidates.clear();
+        int size = static_cast<int>(agent_store.size());
+        for (int index = 0; index < size; index++) {
+            if (is_candidate(agent_store, index, agent_id, location, radius)) {
+                candidates.push_back(index);
+            }
+        }
+    }
+
+    UniformGridNeighbourSearch::UniformGridNeighbourSearch(float separation) : NeighbourSearch(separation) {
+        cell_size = static_cast<double>(separation);
+        buckets_mask = 0;
+    }
+
+    std::unique_ptr<NeighbourSearch> UniformGridNeighbourSearch::clone() const {
+        return std::make_unique<UniformGridNeighbourSearch>(*this);
+    }
+
+    int UniformGridNeighbourSearch::cell_index(double value) const {
+        return static_cast<int>(std::floor(value / cell_size));
+    }
+
+    unsigned int UniformGridNeighbourSearch::bucket_index(int cell_x, int cell_y) const {
+        unsigned int hash_x = static_cast<unsigned int>(cell_x) * 73856093u;
+        unsigned int hash_y = static_cast<unsigned int>(cell_y) * 19349663u;
+        return (hash_x ^ hash_y) & buckets_mask;
+    }
+
+    unsigned int UniformGridNeighbourSearch::bucket_of(const Point2D &location) const {
+        return bucket_index(cell_index(static_cast<double>(location.x)), cell_index(static_cast<double>(location.y)));
+    }
+
+    void UniformGridNeighbourSearch::rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) {
+        // Keep about two buckets per agent, the number of buckets must be a
+        // power of two for the mask to work
+        unsigned long buckets_number = 16;
+        while (buckets_number < 2 * agent_indices.size()) {
+            buckets_number *= 2;
+        }
+
+        if (buckets.size() != buckets_number) {
+            buckets = std::vector<std::vector<int>>(buckets_number);
+            buckets_mask = static_cast<unsigned int>(buckets_number - 1);
+        } else {
+            for (auto &bucket : buckets) {
+                bucket.clear();
+            }
+        }
+
+        agents_bucket.assign(agent_store.size(), not_indexed);
+        for (int index : agent_indices) {
+            agents_bucket[index] = bucket_of(agent_store.locations[index]);
+            buckets[agents_bucket[index]].push_back(index);
+        }
+    }
+
+    void UniformGridNeighbourSearch::update(int agent_index, const Point2D &, const Point2D &new_location) {
+        unsigned int new_bucket = bucket_of(new_location);
+        unsigned int old_bucket = agents_bucket.at(agent_index);
+        if (old_bucket == not_indexed || new_bucket == old_bucket) {
+            return;
+        }
+
+        std::vector<int> &bucket = buckets[old_bucket];
+        auto position = std::find(bucket.begin(), bucket.end(), agent_index);
+        *position = bucket.back();
+        bucket.pop_back();
+
+        buckets[new_bucket].push_back(agent_index);
+        agents_bucket[agent_index] = new_bucket;
+    }
+
+    bool UniformGridNeighbourSearch::collides(const AgentStore &agent_store, int agent_id,
+                                              const Point2D &location) const {
+        // Only agents with x not smaller than the location can collide with it
+        double x = static_cast<double>(location.x);
+        double y = static_cast<double>(location.y);
+        int cell_x_start = cell_index(x);
+        int cell_x_end = cell_index(x + search_radius());
+        int cell_y_start = cell_index(y - search_radius());
+        int cell_y_end = cell_index(y + search_radius());
+
+        for (int cell_x = cell_x_start; cell_x <= cell_x_end; cell_x++) {
+            for (int cell_y = cell_y_start; cell_y <= cell_y_end; cell_y++) {
+                for (int index : buckets[bucket_index(cell_x, cell_y)]) {
+                    if (is_blocking(agent_store, index, agent_id, location)) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    void UniformGridNeighbourSearch::find_candidates(const AgentStore &agent_store, int agent_id,
+                                                     const Point2D &location, double radius,
+                                                     std::vector<int> &candidates) const {
+        candidates.clear();
+        double x = static_cast<double>(location.x);
+        double y = static_cast<double>(location.y);
+        int cell_x_start = cell_index(x - radius);
+        int cell_x_end = cell_index(x + radius);
+        int cell_y_start = cell_index(y - radius);
+        int cell_y_end = cell_index(y + radius);
+
+        // With a large radius the cells would wrap around the hash table and
+        // visit the same buckets several times, scan every agent instead
+        unsigned long cells_number = static_cast<unsigned long>(cell_x_end - cell_x_start + 1) *
+                                     static_cast<unsigned long>(cell_y_end - cell_y_start + 1);
+        if (cells_number > buckets.size() || cells_number > 64) {
+            int size = static_cast<int>(agent_store.size());
+            for (int index = 0; index < size; index++) {
+                if (is_candidate(agent_store, index, agent_id, location, radius)) {
+                    candidates.push_back(index);
+                }
+            }
+            return;
+        }
+
+        // Different cells can share a bucket, visit each bucket only once
+        unsigned int visited_buckets[64];
+        int visited_buckets_number = 0;
+        for (int cell_x = cell_x_start; cell_x <= cell_x_end; cell_x++) {
+            for (int cell_y = cell_y_start; cell_y <= cell_y_end; cell_y++) {
+                unsigned int bucket = bucket_index(cell_x, cell_y);
+                if (std::find(visited_buckets, visited_buckets + visited_buckets_number, bucket) !=
+                    visited_buckets + visited_buckets_number) {
+                    continue;
+                }
+                visited_buckets[visited_buckets_number++] = bucket;
+
+                for (int index : buckets[bucket]) {
+                    if (is_candidate(agent_store, index, agent_id, location, radius)) {
+                        candidates.push_back(index);
+                    }
+                }
+            }
+        }
+    }
+
+    SortedSweepNeighbourSearch::SortedSweepNeighbourSearch(float separation) : NeighbourSearch(separation) {}
+
+    std::unique_ptr<NeighbourSearch> SortedSweepNeighbourSearch::clone() const {
+        return std::make_unique<SortedSweepNeighbourSearch>(*this);
+    }
+
+    void SortedSweepNeighbourSearch::rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) {
+        sorted_agents.resize(agent_indices.size());
+        for (unsigned long i = 0; i < agent_indices.size(); i++) {
+            sorted_agents[i] = {agent_store.locations[agent_indices[i]].x, agent_indices[i]};
+        }
+        std::sort(sorted_agents.begin(), sorted_agents.end());
+
+        agents_slot.assign(agent_store.size(), not_indexed);
+        for (unsigned long slot = 0; slot < sorted_agents.size(); slot++) {
+            agents_slot[sorted_agents[slot].second] = slot;
+        }
+    }
+
+    void SortedSweepNeighbourSearch::update(int agent_index, const Point2D &, const Point2D &new_location) {
+        // Agents move a short distance per step, so restore the order by
+        // moving the agent past its neighbours, as in insertion sort
+        unsigned long slot = agents_slot.at(agent_index);
+        if (slot == not_indexed) {
+            return;
+        }
+        sorted_agents[slot].first = new_location.x;
+
+        while (slot > 0 && sorted_agents[slot] < sorted_agents[slot - 1]) {
+            std::swap(sorted_agents[slot], sorted_agents[slot - 1]);
+            agents_slot[sorted_agents[slot].second] = slot;
+            slot--;
+        }
+        while (slot + 1 < sorted_agents.size() && sorted_agents[slot + 1] < sorted_agents[slot]) {
+            std::swap(sorted_agents[slot], sorted_agents[slot + 1]);
+            agents_slot[sorted_agents[slot].second] = slot;
+            slot++;
+        }
+        agents_slot[agent_index] = slot;
+    }
+
+    bool SortedSweepNeighbourSearch::collides(const AgentStore &agent_store, int agent_id,
+                                              const Point2D &location) const {
+        double x_end = static_cast<double>(location.x) + search_radius();
+
+        auto first = std::lower_bound(sorted_agents.begin(), sorted_agents.end(), location.x,
+                                      [](const std::pair<float, int> &item, float x) { return item.first < x; });
+        for (auto it = first; it != sorted_agents.end() && static_cast<double>(it->first) <= x_end; ++it) {
+            if (is_blocking(agent_store, it->second, agent_id, location)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void SortedSweepNeighbourSearch::find_candidates(const AgentStore &agent_store, int agent_id,
+                                                     const Point2D &location, double radius,
+                                                     std::vector<int> &candidates) const {
+        candidates.clear();
+        double x_start = static_cast<double>(location.x) - radius;
+        double x_end = static_cast<double>(location.x) + radius;
+
+        auto first = std::lower_bound(
+            sorted_agents.begin(), sorted_agents.end(), x_start,
+            [](const std::pair<float, int> &item, double x) { return static_cast<double>(item.first) < x; });
+        for (auto it = first; it != sorted_agents.end() && static_cast<double>(it->first) <= x_end; ++it) {
+            if (is_candidate(agent_store, it->second, agent_id, location, radius)) {
+                candidates.push_back(it->second);
+            }
+        }
+    }
+
+    VerletListNeighbourSearch::VerletListNeighbourSearch(float separation, float skin) : NeighbourSearch(separation) {
+        if (skin <= 0) {
+            throw std::invalid_argument("verlet_skin must be positive!");
+        }
+        this->skin = skin;
+        list_radius = static_cast<double>(separation) + static_cast<double>(skin);
+    }
+
+    std::unique_ptr<NeighbourSearch> VerletListNeighbourSearch::clone() const {
+        return std::make_unique<VerletListNeighbourSearch>(*this);
+    }
+
+    double VerletListNeighbourSearch::distance(const Point2D &a, const Point2D &b) {
+        return std::hypot(static_cast<double>(a.x) - static_cast<double>(b.x),
+                          static_cast<double>(a.y) - static_cast<double>(b.y));
+    }
+
+    // Widened as `search_radius`, so that the lists hold every agent the
+    // single precision tests can find
+    double VerletListNeighbourSearch::build_radius() const { return list_radius * (1.0 + 1.0e-6); }
+
+    void VerletListNeighbourSearch::rebuild(const AgentStore &agent_store, const std::vector<int> &agent_indices) {
+        bool stale = index_states.size() != agent_store.size();
+        if (!stale) {
+            // The agents left out are only marked, an agent indexed again
+            // would have to be removed from the lists of its neighbours first
+            std::vector<char> kept(agent_store.size(), 0);
+            for (int index : agent_indices) {
+                kept[index] = 1;
+                stale = stale || index_states[index] == IndexState::removed;
+            }
+            for (int index : indexed_agents) {
+                if (!kept[index]) {
+                    index_states[index] = IndexState::removed;
+                }
+            }
+
+            // The agents can also have been moved without `update`
+            max_displacement = 0;
+            for (int index : agent_indices) {
+                if (index_states[index] == IndexState::indexed) {
+                    max_displacement = std::max(max_displacement,
+                                                distance(agent_store.locations[index], reference_locations[index]));
+                }
+            }
+            stale = stale || 2 * max_displacement > static_cast<double>(skin);
+        }
+
+        if (stale) {
+            build_lists(agent_store, agent_indices);
+            return;
+        }
+
+        for (int index : agent_indices) {
+            if (index_states[index] == IndexState::not_indexed) {
+                insert_agent(index, agent_store.locations[index]);
+            }
+        }
+        indexed_agents = agent_indices;
+    }
+
+    void VerletListNeighbourSearch::build_lists(const AgentStore &agent_store, const std::vector<int> &agent_indices) {
+        index_states.assign(agent_store.size(), IndexState::not_indexed);
+        reference_locations.resize(agent_store.size());
+        neighbour_lists.resize(agent_store.size());
+        for (auto &neighbour_list : neighbour_lists) {
+            neighbour_list.clear();
+        }
+
+        sorted_references.clear();
+        for (int index : agent_indices) {
+            index_states[index] = IndexState::indexed;
+            reference_locations[index] = agent_store.locations[index];
+            sorted_references.emplace_back(agent_store.locations[index].x, index);
+        }
+        std::sort(sorted_references.begin(), sorted_references.end());
+
+        // Sweep along x, pairing each agent with the agents after it
+        double radius = build_radius();
+        for (auto it = sorted_references.begin(); it != sorted_references.end(); ++it) {
+            const Point2D &location = reference_locations[it->second];
+            for (auto other = it + 1; other != sorted_references.end() &&
+                                      static_cast<double>(other->first) <= static_cast<double>(it->first) + radius;
+                 ++other) {
+                if (distance(location, reference_locations[other->second]) <= radius) {
+                    neighbour_lists[it->second].push_back(other->second);
+                    neighbour_lists[other->second].push_back(it->second);
+                }
+            }
+        }
+
+        indexed_agents = agent_indices;
+        max_displacement = 0;
+        lists_builds_number++;
+    }
+
+    void VerletListNeighbourSearch::insert_agent(int agent_index, const Point2D &location) {
+        index_states[agent_index] = IndexState::indexed;
+        reference_locations[agent_index] = location;
+        neighbour_lists[agent_index].clear();
+
+        double radius = build_radius();
+        auto first = std::lower_bound(
+            sorted_references.begin(), sorted_references.end(), static_cast<double>(location.x) - radius,
+            [](const std::pair<float, int> &item, double x) { return static_cast<double>(item.first) < x; });
+        for (auto it = first;
+             it != sorted_references.end() && static_cast<double>(it->first) <= static_cast<double>(location.x) + radius;
+             ++it) {
+            if (index_states[it->second] == IndexState::indexed && it->second != agent_index &&
+                distance(location, reference_locations[it->second]) <= radius) {
+                neighbour_lists[agent_index].push_back(it->second);
+                neighbour_lists[it->second].push_back(agent_index);
+            }
+        }
+
+        std::pair<float, int> reference(location.x, agent_index);
+        sorted_references.insert(std::upper_bound(sorted_references.begin(), sorted_references.end(), reference),
+                                 reference);
+    }
+
+    void VerletListNeighbourSearch::update(int agent_index, const Point2D &, const Point2D &new_location) {
+        if (index_states.at(agent_index) == IndexState::indexed) {
+            max_displacement = std::max(max_displacement, distance(new_location, reference_locations[agent_index]));
+        }
+    }
+
+    // An agent within `radius` of `location` has its reference location
+    // within `max_displacement + radius + |location - reference of agent_id|`
+    // of the reference location of `agent_id`, so it is in the list if that
+    // is at most `list_radius`
+    bool VerletListNeighbourSearch::lists_cover(int agent_id, const Point2D &location, double radius) const {
+        if (agent_id < 0 || agent_id >= static_cast<int>(index_states.size()) ||
+            index_states[agent_id] != IndexState::indexed) {
+            return false;
+        }
+        return max_displacement + radius + distance(location, reference_locations[agent_id]) <= list_radius;
+    }
+
+    bool VerletListNeighbourSearch::collides(const AgentStore &agent_store, int agent_id,
+                                             const Point2D &location) const {
+        const std::vector<int> &agents =
+            lists_cover(agent_id, location, search_radius()) ? neighbour_lists[agent_id] : indexed_agents;
+        for (int index : agents) {
+            if (index_states[index] == IndexState::indexed && is_blocking(agent_store, index, agent_id, location)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void VerletListNeighbourSearch::find_candidates(const AgentStore &agent_store, int agent_id,
+                                                    const Point2D &location, double radius,
+                                                    std::vector<int> &candidates) const {
+        candidates.clear();
+        const std::vector<int> &agents =
+            lists_cover(agent_id, location, radius) ? neighbour_lists[agent_id] : indexed_agents;
+        for (int index : agents) {
+            if (index_states[index] == IndexState::indexed &&
+                is_candidate(agent_store, index, agent_id, location, radius)) {
+                candidates.push_back(index);
+            }
+        }
+    }
+
+    float VerletListNeighbourSearch::get_skin() const { return skin; }
+
+    unsigned long VerletListNeighbourSearch::get_lists_builds_number() const { return lists_builds_number; }
+} // namespace station_sim
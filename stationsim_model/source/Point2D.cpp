@@ -24,14 +24,9 @@ namespace station_sim {
 
     Point2D Point2D::operator()(float x, float y) { return Point2D(x, y); }
 
-    // Euclidean distance between two points
-    float Point2D::distance(Point2D p) const {
-        return hypot(this->x - p.x, this->y - p.y);
-    }
-
     // Euclidean distance between the given and the segment s1-s2.  Based on
     // https://stackoverflow.com/a/1501725/2442087
-    std::pair<float,Point2D> Point2D::distance_projection(Point2D s1, Point2D s2) const {
+    std::pair<float,Point2D> Point2D::distance_projection(const Point2D &s1, const Point2D &s2) const {
         // Length of segment s1-s2
         const float l = s2.distance(s1);
 
@@ -44,7 +39,8 @@ namespace station_sim {
         // We find projection of point p onto the line.
         // It falls where t = [(p - s1) . (s2 - s1)] / |s2 - s1|^2
         // We clamp t from [0,1] to handle points outside the segment vw.
-        const float t = std::max(0.0e0, std::min(1.0e0, ((this->x - s1.x) * (s2.x - s1.x) + (this->y - s1.y) * (s2.y - s1.y)) / pow(l, 2)));
+        // The square of a float is exact in double, as `pow(l, 2)` was.
+        const float t = std::max(0.0e0, std::min(1.0e0, ((this->x - s1.x) * (s2.x - s1.x) + (this->y - s1.y) * (s2.y - s1.y)) / (static_cast<double>(l) * l)));
         // Projection falls on the segment
         const Point2D projection = Point2D(s1.x + t * (s2.x - s1.x), s1.y + t * (s2.y - s1.y));
         // Return distance and projection, we need both
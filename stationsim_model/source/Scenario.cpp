@@ -0,0 +1,125 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "Scenario.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace station_sim {
+    Scenario::Scenario(const ModelParameters &model_parameters) : model_parameters(model_parameters) {
+        validate();
+
+        station_geometry = StationGeometry(model_parameters.get_boundaries(), model_parameters.get_obstacles(),
+                                           model_parameters.get_raster_cell_size());
+        initialize_derived_data();
+    }
+
+    Scenario::Scenario(const ModelParameters &model_parameters, const Scenario &scenario)
+        : model_parameters(model_parameters) {
+        validate();
+
+        if (scenario.has_same_station(model_parameters)) {
+            station_geometry = scenario.station_geometry;
+        } else {
+            station_geometry = StationGeometry(model_parameters.get_boundaries(), model_parameters.get_obstacles(),
+                                               model_parameters.get_raster_cell_size());
+        }
+        initialize_derived_data();
+    }
+
+    void Scenario::initialize_derived_data() {
+        speed_step = (model_parameters.get_speed_mean() - model_parameters.get_speed_min()) /
+                     static_cast<float>(model_parameters.get_speed_steps());
+
+        for (const Gate &gate : model_parameters.get_gates_in()) {
+            gates_in_locations.push_back(gate.position);
+        }
+        for (const Gate &gate : model_parameters.get_gates_out()) {
+            gates_out_locations.push_back(gate.position);
+        }
+    }
+
+    std::shared_ptr<const Scenario> Scenario::create(const ModelParameters &model_parameters) {
+        return std::make_shared<const Scenario>(model_parameters);
+    }
+
+    std::shared_ptr<const Scenario> Scenario::create(const ModelParameters &model_parameters,
+                                                     const Scenario &scenario) {
+        return std::make_shared<const Scenario>(model_parameters, scenario);
+    }
+
+    // True if the station geometry built from `other_model_parameters` would
+    // be the one of the scenario
+    bool Scenario::has_same_station(const ModelParameters &other_model_parameters) const {
+        auto same_points = [](const std::vector<Point2D> &a, const std::vector<Point2D> &b) {
+            return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Point2D &p, const Point2D &q) {
+                return p.x == q.x && p.y == q.y;
+            });
+        };
+
+        const std::vector<std::vector<Point2D>> &obstacles = model_parameters.get_obstacles();
+        const std::vector<std::vector<Point2D>> &other_obstacles = other_model_parameters.get_obstacles();
+        return model_parameters.get_raster_cell_size() == other_model_parameters.get_raster_cell_size() &&
+               same_points(model_parameters.get_boundaries(), other_model_parameters.get_boundaries()) &&
+               std::equal(obstacles.begin(), obstacles.end(), other_obstacles.begin(), other_obstacles.end(),
+                          same_points);
+    }
+
+    // Reject the parameters which the setters cannot check on their own,
+    // because they depend on each other
+    void Scenario::validate() const {
+        if (model_parameters.get_boundaries().size() < 3) {
+            throw std::invalid_argument("boundaries must have at least 3 vertices!");
+        }
+        for (const std::vector<Point2D> &obstacle : model_parameters.get_obstacles()) {
+            if (obstacle.size() < 3) {
+                throw std::invalid_argument("obstacles must have at least 3 vertices!");
+            }
+        }
+        if (model_parameters.get_gates_in().empty()) {
+            throw std::invalid_argument("gates_in must not be empty!");
+        }
+        if (model_parameters.get_gates_out().empty()) {
+            throw std::invalid_argument("gates_out must not be empty!");
+        }
+        if (!model_parameters.get_agents_locations().empty() &&
+            static_cast<int>(model_parameters.get_agents_locations().size()) !=
+                model_parameters.get_population_total()) {
+            throw std::invalid_argument("agents_locations must have one location per agent!");
+        }
+        if (model_parameters.get_speed_mean() <= model_parameters.get_speed_min()) {
+            throw std::invalid_argument("speed_mean must be greater than speed_min!");
+        }
+        if (model_parameters.is_adaptive_time_step() &&
+            model_parameters.get_min_time_step() > model_parameters.get_time_step()) {
+            throw std::invalid_argument("min_time_step must not be greater than time_step!");
+        }
+    }
+
+    const ModelParameters &Scenario::get_model_parameters() const { return model_parameters; }
+
+    int Scenario::get_population_total() const { return model_parameters.get_population_total(); }
+
+    const std::vector<Point2D> &Scenario::get_agents_locations() const {
+        return model_parameters.get_agents_locations();
+    }
+
+    const std::vector<Point2D> &Scenario::get_boundary_vertices() const { return model_parameters.get_boundaries(); }
+
+    const StationGeometry &Scenario::get_station_geometry() const { return station_geometry; }
+
+    const std::vector<Gate> &Scenario::get_gates_in() const { return model_parameters.get_gates_in(); }
+
+    const std::vector<Gate> &Scenario::get_gates_out() const { return model_parameters.get_gates_out(); }
+
+    const std::vector<Point2D> &Scenario::get_gates_in_locations() const { return gates_in_locations; }
+
+    const std::vector<Point2D> &Scenario::get_gates_out_locations() const { return gates_out_locations; }
+
+    float Scenario::get_speed_step() const { return speed_step; }
+} // namespace station_sim
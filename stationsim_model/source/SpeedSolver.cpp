@@ -0,0 +1,207 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "SpeedSolver.hpp"
+#include "Agent.hpp"
+#include "AgentStore.hpp"
+#include "NeighbourSearch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace station_sim {
+    void SpeedSolver::solve(const AgentStore &agent_store, const NeighbourSearch &neighbour_search,
+                            const StationGeometry &station_geometry, int agent_id, const Point2D &direction,
+                            float max_speed, float min_speed) {
+        this->agent_store = &agent_store;
+        this->neighbour_search = &neighbour_search;
+        this->station_geometry = &station_geometry;
+        this->agent_id = agent_id;
+        candidates.clear();
+        blocking_intervals.clear();
+
+        // Without a direction every speed is tested exactly
+        solved = std::isfinite(direction.x) && std::isfinite(direction.y);
+        if (!solved) {
+            return;
+        }
+
+        const Point2D &location = agent_store.locations[agent_id];
+        float separation = neighbour_search.get_separation();
+        double solver_margin = margin(location, separation, max_speed);
+
+        // The locations of the move lie on a segment, the agents which can
+        // block them are within `separation` of it
+        float half_length = (max_speed - min_speed) / 2;
+        Point2D center(location.x + (min_speed + half_length) * direction.x,
+                       location.y + (min_speed + half_length) * direction.y);
+        double radius =
+            static_cast<double>(half_length) *
+                std::hypot(static_cast<double>(direction.x), static_cast<double>(direction.y)) +
+            static_cast<double>(separation) + 2 * solver_margin;
+        neighbour_search.find_candidates(agent_store, agent_id, center, radius, candidates);
+
+        for (int index : candidates) {
+            BlockingInterval interval{index, 0, 0, 0, 0};
+            agent_blocking_interval(location, direction, agent_store.locations[index],
+                                    static_cast<double>(separation) + solver_margin, solver_margin,
+                                    interval.outer_start, interval.outer_end);
+            if (interval.outer_start > interval.outer_end) {
+                continue;
+            }
+            agent_blocking_interval(location, direction, agent_store.locations[index],
+                                    static_cast<double>(separation) - solver_margin, -solver_margin,
+                                    interval.inner_start, interval.inner_end);
+            blocking_intervals.push_back(interval);
+        }
+
+        boundaries_free_speed = boundaries_free_distance(station_geometry, location, direction, solver_margin);
+    }
+
+    bool SpeedSolver::is_blocked(float speed, const Point2D &new_location) const {
+        if (!solved) {
+            return station_geometry->is_outside(new_location) ||
+                   neighbour_search->collides(*agent_store, agent_id, new_location);
+        }
+
+        double s = static_cast<double>(speed);
+        for (const auto &interval : blocking_intervals) {
+            if (s >= interval.inner_start && s <= interval.inner_end) {
+                return true;
+            }
+        }
+
+        if (s >= boundaries_free_speed && station_geometry->is_outside(new_location)) {
+            return true;
+        }
+
+        for (const auto &interval : blocking_intervals) {
+            if (s >= interval.outer_start && s <= interval.outer_end &&
+                neighbour_search->is_blocking(*agent_store, interval.agent_index, agent_id, new_location)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    double SpeedSolver::margin(const Point2D &location, float separation, float max_speed) {
+        double scale = std::max(std::fabs(static_cast<double>(location.x)), std::fabs(static_cast<double>(location.y)));
+        return 1.0e-5 * (1.0 + scale + static_cast<double>(separation) + static_cast<double>(max_speed));
+    }
+
+    void SpeedSolver::slab_interval(double value, double rate, double lower, double upper, double &s_start,
+                                    double &s_end) {
+        if (rate == 0) {
+            bool inside = value >= lower && value <= upper;
+            s_start = inside ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+            s_end = inside ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+            return;
+        }
+        s_start = (lower - value) / rate;
+        s_end = (upper - value) / rate;
+        if (s_start > s_end) {
+            std::swap(s_start, s_end);
+        }
+    }
+
+    double SpeedSolver::disk_entry(double w_x, double w_y, double d_x, double d_y, double radius) {
+        double a = d_x * d_x + d_y * d_y;
+        double b = w_x * d_x + w_y * d_y;
+        double c = w_x * w_x + w_y * w_y - radius * radius;
+        if (c <= 0) {
+            return 0;
+        }
+        double discriminant = b * b - a * c;
+        if (a == 0 || discriminant < 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        double s_end = (-b + std::sqrt(discriminant)) / a;
+        if (s_end < 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return std::max(0.0, (-b - std::sqrt(discriminant)) / a);
+    }
+
+    void SpeedSolver::agent_blocking_interval(const Point2D &location, const Point2D &direction,
+                                              const Point2D &other, double separation, double x_tolerance,
+                                              double &start, double &end) {
+        start = std::numeric_limits<double>::infinity();
+        end = -std::numeric_limits<double>::infinity();
+
+        double w_x = static_cast<double>(location.x) - static_cast<double>(other.x);
+        double w_y = static_cast<double>(location.y) - static_cast<double>(other.y);
+        double d_x = static_cast<double>(direction.x);
+        double d_y = static_cast<double>(direction.y);
+
+        // Speeds within the disk of radius `separation` around the other agent
+        double a = d_x * d_x + d_y * d_y;
+        double b = w_x * d_x + w_y * d_y;
+        double c = w_x * w_x + w_y * w_y - separation * separation;
+        double discriminant = b * b - a * c;
+        if (separation < 0 || a == 0 || discriminant < 0) {
+            return;
+        }
+        double disk_start = (-b - std::sqrt(discriminant)) / a;
+        double disk_end = (-b + std::sqrt(discriminant)) / a;
+
+        // Intersected with the speeds not ahead of it along the x axis
+        double half_plane_start, half_plane_end;
+        slab_interval(w_x, d_x, -std::numeric_limits<double>::infinity(), x_tolerance, half_plane_start,
+                      half_plane_end);
+
+        start = std::max(disk_start, half_plane_start);
+        end = std::min(disk_end, half_plane_end);
+    }
+
+    double SpeedSolver::boundaries_free_distance(const StationGeometry &station_geometry, const Point2D &location,
+                                                 const Point2D &direction, double margin) {
+        if (station_geometry.is_outside(location)) {
+            return 0;
+        }
+
+        // A path which stays further than `margin` from all the edges cannot
+        // cross them, and the even-odd test is exact along it. Find the first
+        // point of the path within `margin` of an edge, i.e. inside the capsule
+        // made of a rectangle around the edge and two disks at its extrema.
+        double d_x = static_cast<double>(direction.x);
+        double d_y = static_cast<double>(direction.y);
+        double free_distance = std::numeric_limits<double>::infinity();
+
+        for (const GeometryEdge &edge : station_geometry.get_edges()) {
+            double a_x = static_cast<double>(edge.first.x);
+            double a_y = static_cast<double>(edge.first.y);
+            double b_x = static_cast<double>(edge.second.x);
+            double b_y = static_cast<double>(edge.second.y);
+            double w_x = static_cast<double>(location.x) - a_x;
+            double w_y = static_cast<double>(location.y) - a_y;
+
+            free_distance = std::min(free_distance, disk_entry(w_x, w_y, d_x, d_y, margin));
+            free_distance = std::min(free_distance, disk_entry(static_cast<double>(location.x) - b_x,
+                                                               static_cast<double>(location.y) - b_y, d_x, d_y,
+                                                               margin));
+
+            double length = std::hypot(b_x - a_x, b_y - a_y);
+            if (length == 0) {
+                continue;
+            }
+            double t_x = (b_x - a_x) / length;
+            double t_y = (b_y - a_y) / length;
+
+            double along_start, along_end, across_start, across_end;
+            slab_interval(w_x * t_x + w_y * t_y, d_x * t_x + d_y * t_y, 0, length, along_start, along_end);
+            slab_interval(w_y * t_x - w_x * t_y, d_y * t_x - d_x * t_y, -margin, margin, across_start, across_end);
+
+            double s_start = std::max({along_start, across_start, 0.0});
+            double s_end = std::min(along_end, across_end);
+            if (s_start <= s_end) {
+                free_distance = std::min(free_distance, s_start);
+            }
+        }
+        return free_distance;
+    }
+} // namespace station_sim
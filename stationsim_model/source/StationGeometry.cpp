@@ -0,0 +1,262 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "StationGeometry.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace station_sim {
+    StationGeometry::StationGeometry(const std::vector<Point2D> &boundary_vertices,
+                                     const std::vector<std::vector<Point2D>> &obstacles, float raster_cell_size)
+        : boundary_vertices(boundary_vertices), obstacles(obstacles) {
+        add_ring(boundary_vertices);
+        for (const std::vector<Point2D> &obstacle : obstacles) {
+            add_ring(obstacle);
+        }
+
+        min_x = min_y = std::numeric_limits<float>::max();
+        max_x = max_y = std::numeric_limits<float>::lowest();
+        for (const GeometryEdge &edge : edges) {
+            min_x = std::min({min_x, edge.first.x, edge.second.x});
+            max_x = std::max({max_x, edge.first.x, edge.second.x});
+            min_y = std::min({min_y, edge.first.y, edge.second.y});
+            max_y = std::max({max_y, edge.first.y, edge.second.y});
+        }
+
+        // A rectangle has its four corners as vertices and only axis-aligned
+        // edges, anything else could be degenerate
+        if (obstacles.empty() && edges.size() == 4 && min_x < max_x && min_y < max_y) {
+            unsigned int corners = 0;
+            bool axis_aligned = true;
+            for (const GeometryEdge &edge : edges) {
+                if ((edge.second.x == min_x || edge.second.x == max_x) &&
+                    (edge.second.y == min_y || edge.second.y == max_y)) {
+                    corners |= 1u << ((edge.second.x == max_x ? 2u : 0u) + (edge.second.y == max_y ? 1u : 0u));
+                }
+                axis_aligned = axis_aligned && (edge.delta_x == 0 || edge.delta_y == 0);
+            }
+            axis_aligned_rectangle = axis_aligned && corners == 0xF;
+        }
+
+        build_bands();
+        if (raster_cell_size > 0) {
+            build_raster(raster_cell_size);
+        }
+    }
+
+    // Edges between consecutive vertices, in the order of the vertices, and
+    // the edge closing the ring. Edges of zero length never cross anything.
+    void StationGeometry::add_ring(const std::vector<Point2D> &vertices) {
+        for (unsigned long i = 0; i < vertices.size(); i++) {
+            const Point2D &first = i + 1 < vertices.size() ? vertices[i] : vertices.back();
+            const Point2D &second = i + 1 < vertices.size() ? vertices[i + 1] : vertices.front();
+            if (first.x == second.x && first.y == second.y) {
+                continue;
+            }
+            edges.push_back(GeometryEdge{first, second, first.x - second.x, first.y - second.y});
+        }
+    }
+
+    // Counting sort of the edges into as many bands as edges, each edge
+    // listed in all the bands its y range overlaps
+    void StationGeometry::build_bands() {
+        unsigned long bands_number = std::max(1ul, static_cast<unsigned long>(edges.size()));
+        band_height = (max_y - min_y) / static_cast<float>(bands_number);
+        if (!(band_height > 0)) {
+            band_height = 1;
+        }
+
+        band_offsets.assign(bands_number + 1, 0);
+        for (const GeometryEdge &edge : edges) {
+            for (unsigned long band = band_index(std::min(edge.first.y, edge.second.y));
+                 band <= band_index(std::max(edge.first.y, edge.second.y)); band++) {
+                band_offsets[band + 1]++;
+            }
+        }
+        for (unsigned long band = 0; band < bands_number; band++) {
+            band_offsets[band + 1] += band_offsets[band];
+        }
+
+        band_edges.resize(band_offsets.back());
+        std::vector<unsigned long> positions(band_offsets.begin(), band_offsets.end() - 1);
+        for (int index = 0; index < static_cast<int>(edges.size()); index++) {
+            const GeometryEdge &edge = edges[index];
+            for (unsigned long band = band_index(std::min(edge.first.y, edge.second.y));
+                 band <= band_index(std::max(edge.first.y, edge.second.y)); band++) {
+                band_edges[positions[band]++] = index;
+            }
+        }
+    }
+
+    // Non decreasing in `y`, so an edge is in the band of every `y` of its range
+    unsigned long StationGeometry::band_index(float y) const {
+        unsigned long bands_number = band_offsets.size() - 1;
+        float position = (y - min_y) / band_height;
+        if (!(position > 0)) {
+            return 0;
+        }
+        if (position >= static_cast<float>(bands_number)) {
+            return bands_number - 1;
+        }
+        return std::min(static_cast<unsigned long>(position), bands_number - 1);
+    }
+
+    bool StationGeometry::crosses_ray(const GeometryEdge &edge, const Point2D &location) {
+        return ((edge.second.y > location.y) != (edge.first.y > location.y)) &&
+               (location.x < edge.second.x + edge.delta_x * (location.y - edge.second.y) / edge.delta_y);
+    }
+
+    // Sides and candidate edges of the cells, from the distances of their
+    // centres to the edges. The tolerance covers the rounding of the
+    // locations and of the single precision distances of the exact tests.
+    void StationGeometry::build_raster(float cell_size) {
+        if (edges.empty()) {
+            return;
+        }
+
+        unsigned long columns = static_cast<unsigned long>(std::ceil((max_x - min_x) / cell_size)) + 2 * raster_padding;
+        unsigned long rows = static_cast<unsigned long>(std::ceil((max_y - min_y) / cell_size)) + 2 * raster_padding;
+        if (columns * rows > max_raster_cells) {
+            throw std::invalid_argument("raster_cell_size is too small for the station!");
+        }
+
+        double half_diagonal = static_cast<double>(cell_size) * std::sqrt(2.0) / 2;
+        double scale = std::max({std::fabs(min_x), std::fabs(max_x), std::fabs(min_y), std::fabs(max_y)});
+        double tolerance = 1.0e-5 * (1.0 + scale) + 1.0e-3 * static_cast<double>(cell_size);
+        Point2D origin(min_x - static_cast<float>(raster_padding) * cell_size,
+                       min_y - static_cast<float>(raster_padding) * cell_size);
+
+        std::vector<signed char> sides(columns * rows, 0);
+        std::vector<unsigned long> offsets(columns * rows + 1, 0);
+        std::vector<int> cell_edges;
+        std::vector<double> distances(edges.size());
+        for (unsigned long row = 0; row < rows; row++) {
+            for (unsigned long column = 0; column < columns; column++) {
+                double x = static_cast<double>(origin.x) + (static_cast<double>(column) + 0.5) * cell_size;
+                double y = static_cast<double>(origin.y) + (static_cast<double>(row) + 0.5) * cell_size;
+                double min_distance = std::numeric_limits<double>::infinity();
+                for (unsigned long i = 0; i < edges.size(); i++) {
+                    distances[i] = edge_distance(edges[i], x, y);
+                    min_distance = std::min(min_distance, distances[i]);
+                }
+
+                unsigned long cell = row * columns + column;
+                if (min_distance > half_diagonal + tolerance) {
+                    sides[cell] = is_outside_exact(Point2D(static_cast<float>(x), static_cast<float>(y))) ? 1 : -1;
+                }
+                // An edge further than this from the centre is further than the
+                // closest edge from every location of the cell
+                for (int i = 0; i < static_cast<int>(edges.size()); i++) {
+                    if (distances[i] <= min_distance + 2 * half_diagonal + tolerance) {
+                        cell_edges.push_back(i);
+                    }
+                }
+                offsets[cell + 1] = cell_edges.size();
+            }
+        }
+
+        raster_cell_size = cell_size;
+        raster_origin = origin;
+        raster_columns = columns;
+        raster_rows = rows;
+        raster_sides = std::move(sides);
+        raster_offsets = std::move(offsets);
+        raster_edges = std::move(cell_edges);
+    }
+
+    bool StationGeometry::find_raster_cell(const Point2D &location, unsigned long &cell) const {
+        if (raster_sides.empty()) {
+            return false;
+        }
+
+        float column = (location.x - raster_origin.x) / raster_cell_size;
+        float row = (location.y - raster_origin.y) / raster_cell_size;
+        if (!(column >= 0 && row >= 0 && column < static_cast<float>(raster_columns) &&
+              row < static_cast<float>(raster_rows))) {
+            return false;
+        }
+        cell = std::min(static_cast<unsigned long>(row), raster_rows - 1) * raster_columns +
+               std::min(static_cast<unsigned long>(column), raster_columns - 1);
+        return true;
+    }
+
+    double StationGeometry::edge_distance(const GeometryEdge &edge, double x, double y) {
+        double a_x = static_cast<double>(edge.first.x);
+        double a_y = static_cast<double>(edge.first.y);
+        double d_x = static_cast<double>(edge.second.x) - a_x;
+        double d_y = static_cast<double>(edge.second.y) - a_y;
+        double t = ((x - a_x) * d_x + (y - a_y) * d_y) / (d_x * d_x + d_y * d_y);
+        t = std::max(0.0, std::min(1.0, t));
+        return std::hypot(x - (a_x + t * d_x), y - (a_y + t * d_y));
+    }
+
+    bool StationGeometry::is_outside(const Point2D &location) const {
+        if (axis_aligned_rectangle) {
+            return !(location.x >= min_x && location.x < max_x && location.y >= min_y && location.y < max_y);
+        }
+
+        unsigned long cell;
+        if (find_raster_cell(location, cell) && raster_sides[cell] != 0) {
+            return raster_sides[cell] > 0;
+        }
+        return is_outside_exact(location);
+    }
+
+    bool StationGeometry::is_outside_exact(const Point2D &location) const {
+        if (edges.empty()) {
+            return true;
+        }
+
+        unsigned long band = band_index(location.y);
+        bool inside = false;
+        for (unsigned long i = band_offsets[band]; i < band_offsets[band + 1]; i++) {
+            if (crosses_ray(edges[band_edges[i]], location)) {
+                inside = !inside;
+            }
+        }
+        return !inside;
+    }
+
+    // The candidate edges of a cell are in the order of the edges, so ties
+    // are broken as when searching all the edges
+    Point2D StationGeometry::closest_edge_point(const Point2D &location) const {
+        float min_distance = std::numeric_limits<float>::max();
+        Point2D closest_point = location;
+        auto test_edge = [&](const GeometryEdge &edge) {
+            std::pair<float, Point2D> distance_projection = location.distance_projection(edge.first, edge.second);
+            if (distance_projection.first < min_distance) {
+                min_distance = distance_projection.first;
+                closest_point = distance_projection.second;
+            }
+        };
+
+        unsigned long cell;
+        if (find_raster_cell(location, cell)) {
+            for (unsigned long i = raster_offsets[cell]; i < raster_offsets[cell + 1]; i++) {
+                test_edge(edges[raster_edges[i]]);
+            }
+        } else {
+            std::for_each(edges.begin(), edges.end(), test_edge);
+        }
+        return closest_point;
+    }
+
+    const std::vector<Point2D> &StationGeometry::get_boundary_vertices() const { return boundary_vertices; }
+
+    const std::vector<std::vector<Point2D>> &StationGeometry::get_obstacles() const { return obstacles; }
+
+    const std::vector<GeometryEdge> &StationGeometry::get_edges() const { return edges; }
+
+    bool StationGeometry::is_axis_aligned_rectangle() const { return axis_aligned_rectangle; }
+
+    bool StationGeometry::has_raster() const { return !raster_sides.empty(); }
+
+    float StationGeometry::get_raster_cell_size() const { return raster_cell_size; }
+} // namespace station_sim
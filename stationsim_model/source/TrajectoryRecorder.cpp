@@ -0,0 +1,209 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#include "TrajectoryRecorder.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace station_sim {
+    TrajectoryRecorder::TrajectoryRecorder(unsigned long agents_number, int stride, unsigned long memory_limit) {
+        reset(agents_number, stride, memory_limit);
+    }
+
+    TrajectoryRecorder::TrajectoryRecorder(const TrajectoryRecorder &trajectory_recorder) {
+        *this = trajectory_recorder;
+    }
+
+    TrajectoryRecorder &TrajectoryRecorder::operator=(const TrajectoryRecorder &trajectory_recorder) {
+        if (this == &trajectory_recorder) {
+            return *this;
+        }
+
+        agents_number = trajectory_recorder.agents_number;
+        stride = trajectory_recorder.stride;
+        memory_limit = trajectory_recorder.memory_limit;
+        frames_per_chunk = trajectory_recorder.frames_per_chunk;
+        frames_number = trajectory_recorder.frames_number;
+        frame_times = trajectory_recorder.frame_times;
+        chunks = trajectory_recorder.chunks;
+        first_chunk_in_memory = trajectory_recorder.first_chunk_in_memory;
+
+        // The spilled chunks are copied to a file of the copy, so that both
+        // can keep appending to their own file
+        spill_file.reset();
+        if (trajectory_recorder.spill_file) {
+            spill_file.reset(std::tmpfile());
+            if (!spill_file) {
+                throw std::runtime_error("cannot create the trajectory spill file!");
+            }
+
+            std::FILE *source = trajectory_recorder.spill_file.get();
+            std::fseek(source, 0, SEEK_SET);
+            std::array<char, 1 << 16> buffer;
+            std::size_t read_bytes;
+            while ((read_bytes = std::fread(buffer.data(), 1, buffer.size(), source)) > 0) {
+                if (std::fwrite(buffer.data(), 1, read_bytes, spill_file.get()) != read_bytes) {
+                    throw std::runtime_error("cannot write the trajectory spill file!");
+                }
+            }
+        }
+
+        return *this;
+    }
+
+    void TrajectoryRecorder::reset(unsigned long agents_number, int stride, unsigned long memory_limit) {
+        if (stride <= 0) {
+            throw std::invalid_argument("stride must be positive!");
+        }
+
+        unsigned long previous_chunk_size = chunk_size();
+        this->agents_number = agents_number;
+        this->stride = stride;
+        this->memory_limit = memory_limit;
+        frames_per_chunk = std::max(1ul, chunk_bytes / (std::max(1ul, agents_number) * sizeof(Point2D)));
+
+        if (chunk_size() == previous_chunk_size) {
+            for (unsigned long i = first_chunk_in_memory; i < chunks.size(); i++) {
+                chunks[i].locations.clear();
+                spare_chunks.push_back(std::move(chunks[i].locations));
+            }
+        } else {
+            spare_chunks.clear();
+        }
+        chunks.clear();
+        frames_number = 0;
+        frame_times.clear();
+        first_chunk_in_memory = 0;
+        spill_file.reset();
+    }
+
+    void TrajectoryRecorder::record(int step, const std::vector<Point2D> &locations) {
+        record(step, locations, static_cast<double>(step));
+    }
+
+    void TrajectoryRecorder::record(int step, const std::vector<Point2D> &locations, double time) {
+        if (!is_recorded(step)) {
+            return;
+        }
+
+        if (frames_number % frames_per_chunk == 0) {
+            chunks.emplace_back();
+            if (!spare_chunks.empty()) {
+                chunks.back().locations = std::move(spare_chunks.back());
+                spare_chunks.pop_back();
+            }
+            chunks.back().locations.reserve(chunk_size());
+        }
+        std::vector<Point2D> &chunk_locations = chunks.back().locations;
+        chunk_locations.insert(chunk_locations.end(), locations.begin(),
+                               locations.begin() + static_cast<std::vector<Point2D>::difference_type>(agents_number));
+        frame_times.push_back(time);
+        frames_number++;
+
+        if (memory_limit > 0) {
+            spill_chunks();
+        }
+    }
+
+    bool TrajectoryRecorder::is_recorded(int step) const { return step % stride == 0; }
+
+    unsigned long TrajectoryRecorder::get_frames_number() const { return frames_number; }
+
+    int TrajectoryRecorder::get_frame_step(unsigned long frame) const { return static_cast<int>(frame) * stride; }
+
+    double TrajectoryRecorder::get_frame_time(unsigned long frame) const {
+        if (frame >= frames_number) {
+            throw std::out_of_range("frame has not been recorded!");
+        }
+
+        return frame_times[frame];
+    }
+
+    int TrajectoryRecorder::get_stride() const { return stride; }
+
+    unsigned long TrajectoryRecorder::get_memory_usage() const {
+        unsigned long memory_usage = 0;
+        for (unsigned long i = first_chunk_in_memory; i < chunks.size(); i++) {
+            memory_usage += chunks[i].locations.capacity() * sizeof(Point2D);
+        }
+        return memory_usage;
+    }
+
+    std::vector<Point2D> TrajectoryRecorder::get_frame(unsigned long frame) const {
+        if (frame >= frames_number) {
+            throw std::out_of_range("frame has not been recorded!");
+        }
+
+        const Chunk &chunk = chunks[frame / frames_per_chunk];
+        unsigned long begin = (frame % frames_per_chunk) * agents_number;
+        std::vector<Point2D> frame_locations(agents_number);
+        if (chunk.spill_offset < 0) {
+            std::copy_n(chunk.locations.begin() + static_cast<std::vector<Point2D>::difference_type>(begin),
+                        agents_number, frame_locations.begin());
+        } else {
+            std::fseek(spill_file.get(), chunk.spill_offset + static_cast<long>(begin * sizeof(Point2D)), SEEK_SET);
+            if (std::fread(frame_locations.data(), sizeof(Point2D), agents_number, spill_file.get()) !=
+                agents_number) {
+                throw std::runtime_error("cannot read the trajectory spill file!");
+            }
+        }
+        return frame_locations;
+    }
+
+    std::vector<Point2D> TrajectoryRecorder::get_agent_trajectory(int agent_id) const {
+        std::vector<Point2D> trajectory;
+        trajectory.reserve(frames_number);
+        for (unsigned long i = 0; i < chunks.size(); i++) {
+            std::vector<Point2D> spilled_locations;
+            const std::vector<Point2D> &chunk_locations =
+                chunks[i].spill_offset < 0 ? chunks[i].locations : (spilled_locations = read_chunk(i));
+
+            for (unsigned long j = static_cast<unsigned long>(agent_id); j < chunk_locations.size();
+                 j += agents_number) {
+                trajectory.push_back(chunk_locations[j]);
+            }
+        }
+        return trajectory;
+    }
+
+    unsigned long TrajectoryRecorder::chunk_size() const { return frames_per_chunk * agents_number; }
+
+    std::vector<Point2D> TrajectoryRecorder::read_chunk(unsigned long chunk) const {
+        std::vector<Point2D> chunk_locations(chunk_size());
+        std::fseek(spill_file.get(), chunks[chunk].spill_offset, SEEK_SET);
+        if (std::fread(chunk_locations.data(), sizeof(Point2D), chunk_locations.size(), spill_file.get()) !=
+            chunk_locations.size()) {
+            throw std::runtime_error("cannot read the trajectory spill file!");
+        }
+        return chunk_locations;
+    }
+
+    // Write the oldest full chunks to the spill file until the chunks in
+    // memory fit in the memory limit. The chunk being filled stays in memory.
+    void TrajectoryRecorder::spill_chunks() {
+        while (get_memory_usage() > memory_limit && first_chunk_in_memory + 1 < chunks.size()) {
+            if (!spill_file) {
+                spill_file.reset(std::tmpfile());
+                if (!spill_file) {
+                    throw std::runtime_error("cannot create the trajectory spill file!");
+                }
+            }
+
+            Chunk &chunk = chunks[first_chunk_in_memory];
+            std::fseek(spill_file.get(), 0, SEEK_END);
+            chunk.spill_offset = std::ftell(spill_file.get());
+            if (std::fwrite(chunk.locations.data(), sizeof(Point2D), chunk.locations.size(), spill_file.get()) !=
+                chunk.locations.size()) {
+                throw std::runtime_error("cannot write the trajectory spill file!");
+            }
+            std::vector<Point2D>().swap(chunk.locations);
+            first_chunk_in_memory++;
+        }
+    }
+} // namespace station_sim
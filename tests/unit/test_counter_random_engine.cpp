@@ -0,0 +1,61 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <cstdint>
+#include <random>
+
+#include "catch.hpp"
+#include "CounterRandomEngine.hpp"
+
+using namespace particle_filter;
+
+TEST_CASE("Test CounterRandomEngine") {
+
+    SECTION("Test known answers of Philox-4x32-10") {
+        CounterRandomEngine zero_engine(0, 0, 0, 0, 0);
+        REQUIRE(zero_engine() == 0x6627e8d5);
+        REQUIRE(zero_engine() == 0xe169c58d);
+        REQUIRE(zero_engine() == 0xbc57ac4c);
+        REQUIRE(zero_engine() == 0x9b00dbd8);
+    }
+
+    SECTION("Test the numbers depend only on the key and the counter") {
+        CounterRandomEngine engine_a(42, 1, 2, 3, 4);
+        CounterRandomEngine engine_b(42, 1, 2, 3, 4);
+        CounterRandomEngine engine_c(42, 1, 2, 3, 5);
+        CounterRandomEngine engine_d(43, 1, 2, 3, 4);
+
+        bool differs_by_counter = false;
+        bool differs_by_seed = false;
+        for (int i = 0; i < 100; i++) {
+            std::uint32_t value = engine_a();
+            REQUIRE(value == engine_b());
+            differs_by_counter |= value != engine_c();
+            differs_by_seed |= value != engine_d();
+        }
+        REQUIRE(differs_by_counter);
+        REQUIRE(differs_by_seed);
+    }
+
+    SECTION("Test the engine works with the standard distributions") {
+        CounterRandomEngine engine(7, 0);
+        std::uniform_real_distribution<double> distribution(0, 1);
+
+        double sum = 0;
+        int samples = 100000;
+        for (int i = 0; i < samples; i++) {
+            double value = distribution(engine);
+            REQUIRE(value >= 0);
+            REQUIRE(value < 1);
+            sum += value;
+        }
+        REQUIRE(sum / samples == Approx(0.5).epsilon(0.01));
+    }
+}
@@ -0,0 +1,98 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_RUNNER
+
+#include "catch.hpp"
+#include "DomainDecomposition.hpp"
+#include "Model.hpp"
+#include "ModelParameters.hpp"
+#include "mpi.h"
+
+using namespace station_sim;
+
+// Run with any number of ranks, e.g. `mpiexec -n 3 test_domain_decomposition`
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int result = Catch::Session().run(argc, argv);
+    MPI_Finalize();
+    return result;
+}
+
+TEST_CASE("Test DomainDecomposition") {
+    ModelParameters model_parameters;
+    model_parameters.set_population_total(300);
+    model_parameters.set_do_print(false);
+    model_parameters.set_random_seed(11);
+    model_parameters.set_agent_update_mode(AgentUpdateMode::synchronous);
+
+    SECTION("Test the strips cover the station") {
+        DomainDecomposition domain(MPI_COMM_WORLD, model_parameters.get_boundaries(), 1, 10);
+        REQUIRE(domain.strip_of(-1000) == 0);
+        REQUIRE(domain.strip_of(0) == 0);
+        REQUIRE(domain.strip_of(1000) == domain.get_ranks_number() - 1);
+        for (float x = 0; x < 200; x += 0.5f) {
+            REQUIRE(domain.strip_of(x) <= domain.strip_of(x + 0.5f));
+        }
+    }
+
+    SECTION("Test a distributed model moves as a single model") {
+        Model model(0, model_parameters);
+        Model distributed_model(0, model_parameters);
+        distributed_model.distribute(MPI_COMM_WORLD);
+
+        for (int step = 0; step < 400; step++) {
+            model.step();
+            distributed_model.step();
+
+            // Every active agent is moved by exactly one rank
+            int owned_agents = 0;
+            for (int agent_id : distributed_model.get_active_agents()) {
+                owned_agents += distributed_model.get_domain_decomposition()->owns(agent_id);
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &owned_agents, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+            REQUIRE(owned_agents == static_cast<int>(distributed_model.get_active_agents().size()));
+        }
+
+        REQUIRE(distributed_model.pop_finished == model.pop_finished);
+        REQUIRE(distributed_model.pop_active == model.pop_active);
+        REQUIRE(distributed_model.get_active_agents() == model.get_active_agents());
+
+        ModelState state = model.get_state();
+        ModelState distributed_state = distributed_model.get_state();
+        std::vector<int> collisions(static_cast<unsigned long>(model_parameters.get_population_total()));
+        for (int i = 0; i < model_parameters.get_population_total(); i++) {
+            REQUIRE(distributed_state.agents_location[i].x == state.agents_location[i].x);
+            REQUIRE(distributed_state.agents_location[i].y == state.agents_location[i].y);
+            REQUIRE(distributed_state.agent_active_status[i] == state.agent_active_status[i]);
+            collisions[i] = distributed_model.agents[i].get_history_collisions();
+        }
+
+        // The collisions of an agent are counted by the ranks which moved it
+        MPI_Allreduce(MPI_IN_PLACE, collisions.data(), static_cast<int>(collisions.size()), MPI_INT, MPI_SUM,
+                      MPI_COMM_WORLD);
+        for (int i = 0; i < model_parameters.get_population_total(); i++) {
+            REQUIRE(collisions[i] == model.agents[i].get_history_collisions());
+        }
+
+        std::vector<Point2D> trajectory = model.get_trajectory_recorder().get_agent_trajectory(17);
+        std::vector<Point2D> distributed_trajectory =
+            distributed_model.get_trajectory_recorder().get_agent_trajectory(17);
+        REQUIRE(distributed_trajectory.size() == trajectory.size());
+        for (unsigned long i = 0; i < trajectory.size(); i++) {
+            REQUIRE(distributed_trajectory[i].x == trajectory[i].x);
+            REQUIRE(distributed_trajectory[i].y == trajectory[i].y);
+        }
+    }
+
+    SECTION("Test only the synchronous update can be distributed") {
+        model_parameters.set_agent_update_mode(AgentUpdateMode::sequential);
+        Model model(0, model_parameters);
+        REQUIRE_THROWS_AS(model.distribute(MPI_COMM_WORLD), std::invalid_argument);
+    }
+}
@@ -14,6 +14,10 @@
 #include "Model.hpp"
 #include "ModelParameters.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace station_sim;
 
 TEST_CASE("Test Model") {
@@ -24,4 +28,442 @@ TEST_CASE("Test Model") {
         REQUIRE(model.get_unique_id() == 10);
         std::cout << model.get_speed_step() << std::endl;
     }
+
+    SECTION("Test agents are handles to the model's agent store") {
+        REQUIRE(model.agents.size() == model.get_agent_store().size());
+
+        model.agents.at(3).set_agent_location(Point2D(12, 34));
+        REQUIRE(model.get_agent_store().locations.at(3).x == 12);
+        REQUIRE(model.get_agent_store().locations.at(3).y == 34);
+
+        // A copy of the model must not share its agents with the original
+        Model model_copy(model);
+        model_copy.agents.at(3).set_agent_location(Point2D(56, 78));
+        REQUIRE(model.agents.at(3).get_agent_location().x == 12);
+        REQUIRE(model_copy.get_agent_store().locations.at(3).x == 56);
+    }
+
+    SECTION("Test synchronous update does not depend on the number of threads") {
+        ModelParameters synchronous_parameters;
+        synchronous_parameters.set_population_total(500);
+        synchronous_parameters.set_do_print(false);
+        synchronous_parameters.set_agent_update_mode(AgentUpdateMode::synchronous);
+        Model model_a(0, synchronous_parameters);
+        Model model_b(model_a);
+
+        for (int threads : {1, 3}) {
+#ifdef _OPENMP
+            omp_set_num_threads(threads);
+#endif
+            Model &stepped_model = threads == 1 ? model_a : model_b;
+            for (int i = 0; i < 300; i++) {
+                stepped_model.step();
+            }
+        }
+
+        REQUIRE(model_a.pop_finished == model_b.pop_finished);
+        for (int i = 0; i < synchronous_parameters.get_population_total(); i++) {
+            REQUIRE(model_a.agents[i].get_agent_location().x == model_b.agents[i].get_agent_location().x);
+            REQUIRE(model_a.agents[i].get_agent_location().y == model_b.agents[i].get_agent_location().y);
+            REQUIRE(model_a.agents[i].get_history_collisions() == model_b.agents[i].get_history_collisions());
+        }
+    }
+
+    SECTION("Test models with the same seed are reproducible") {
+        ModelParameters seeded_parameters;
+        seeded_parameters.set_population_total(200);
+        seeded_parameters.set_do_print(false);
+        seeded_parameters.set_random_seed(1234);
+        Model model_a(5, seeded_parameters);
+        Model model_b(5, seeded_parameters);
+        Model model_c(6, seeded_parameters);
+
+        for (int i = 0; i < 200; i++) {
+            model_a.step();
+            model_b.step();
+        }
+
+        bool differs_from_other_model = false;
+        for (int i = 0; i < seeded_parameters.get_population_total(); i++) {
+            REQUIRE(model_a.agents[i].get_agent_location().x == model_b.agents[i].get_agent_location().x);
+            REQUIRE(model_a.agents[i].get_agent_location().y == model_b.agents[i].get_agent_location().y);
+            REQUIRE(model_a.agents[i].get_history_wiggles() == model_b.agents[i].get_history_wiggles());
+            differs_from_other_model |=
+                model_a.get_agent_store().max_speeds[i] != model_c.get_agent_store().max_speeds[i];
+        }
+        REQUIRE(differs_from_other_model);
+    }
+
+    SECTION("Test a particle clone steps as the model without its history") {
+        ModelParameters clone_parameters;
+        clone_parameters.set_population_total(100);
+        clone_parameters.set_do_print(false);
+        Model model_a(3, clone_parameters);
+        for (int i = 0; i < 50; i++) {
+            model_a.step();
+        }
+
+        Model particle = model_a.clone_particle();
+        REQUIRE_FALSE(particle.is_do_history());
+        REQUIRE(particle.get_trajectory_recorder().get_frames_number() == 0);
+        REQUIRE(particle.get_agent_store().histories.size() == model_a.get_agent_store().histories.size());
+
+        // The clone must not share its agents with the model
+        particle.agents.at(0).set_agent_location(Point2D(1, 2));
+        REQUIRE(model_a.agents.at(0).get_agent_location().x != 1);
+        particle.agents.at(0).set_agent_location(model_a.agents.at(0).get_agent_location());
+
+        for (int i = 0; i < 200; i++) {
+            model_a.step();
+            particle.step();
+        }
+        REQUIRE(model_a.pop_finished == particle.pop_finished);
+        for (int i = 0; i < clone_parameters.get_population_total(); i++) {
+            REQUIRE(model_a.agents[i].get_agent_location().x == particle.agents[i].get_agent_location().x);
+            REQUIRE(model_a.agents[i].get_agent_location().y == particle.agents[i].get_agent_location().y);
+        }
+    }
+
+    SECTION("Test the step kernels give the same moves whatever the policy") {
+        ModelParameters policy_parameters;
+        policy_parameters.set_population_total(200);
+        policy_parameters.set_do_print(false);
+        policy_parameters.set_random_seed(99);
+        Model reference_model(0, policy_parameters);
+
+        std::vector<Model> models;
+        for (bool do_history : {false, true}) {
+            for (NeighbourSearchType type : {NeighbourSearchType::brute_force, NeighbourSearchType::sorted_sweep,
+                                             NeighbourSearchType::verlet_list}) {
+                ModelParameters kernel_parameters = policy_parameters;
+                kernel_parameters.set_do_history(do_history);
+                kernel_parameters.set_neighbour_search_type(type);
+                models.emplace_back(0, kernel_parameters);
+            }
+        }
+
+        for (int i = 0; i < 300; i++) {
+            reference_model.step();
+            for (auto &kernel_model : models) {
+                kernel_model.step();
+            }
+        }
+
+        for (const auto &kernel_model : models) {
+            REQUIRE(kernel_model.pop_finished == reference_model.pop_finished);
+            for (int i = 0; i < policy_parameters.get_population_total(); i++) {
+                REQUIRE(kernel_model.agents[i].get_agent_location().x ==
+                        reference_model.agents[i].get_agent_location().x);
+                REQUIRE(kernel_model.agents[i].get_agent_location().y ==
+                        reference_model.agents[i].get_agent_location().y);
+            }
+        }
+    }
+
+    SECTION("Test agents are activated at their activation step") {
+        ModelParameters schedule_parameters;
+        schedule_parameters.set_population_total(200);
+        schedule_parameters.set_do_print(false);
+        Model schedule_model(0, schedule_parameters);
+        const AgentStore &agent_store = schedule_model.get_agent_store();
+
+        for (int step = 0; step < 400; step++) {
+            schedule_model.step();
+
+            std::vector<int> active_agents;
+            for (int i = 0; i < schedule_parameters.get_population_total(); i++) {
+                bool due = agent_store.cold_data[i].steps_activate <= step;
+                REQUIRE(due == (agent_store.statuses[i] != AgentStatus::not_started));
+                if (agent_store.statuses[i] == AgentStatus::active) {
+                    active_agents.push_back(i);
+                }
+            }
+            REQUIRE(schedule_model.get_active_agents() == active_agents);
+            REQUIRE(schedule_model.pop_active == static_cast<int>(active_agents.size()));
+        }
+    }
+
+    SECTION("Test sorting the agents by location does not change the moves") {
+        ModelParameters sorted_parameters;
+        sorted_parameters.set_population_total(300);
+        sorted_parameters.set_do_print(false);
+        sorted_parameters.set_random_seed(7);
+
+        for (AgentUpdateMode mode : {AgentUpdateMode::sequential, AgentUpdateMode::synchronous}) {
+            sorted_parameters.set_agent_update_mode(mode);
+            sorted_parameters.set_reorder_period(0);
+            Model reference_model(0, sorted_parameters);
+            sorted_parameters.set_reorder_period(10);
+            Model sorted_model(0, sorted_parameters);
+
+            for (int i = 0; i < 300; i++) {
+                reference_model.step();
+                sorted_model.step();
+            }
+
+            bool sorted = false;
+            for (int i = 0; i < sorted_parameters.get_population_total(); i++) {
+                sorted |= sorted_model.agents[i].get_store_slot() != i;
+                REQUIRE(sorted_model.agents[i].get_agent_id() == i);
+            }
+            REQUIRE(sorted);
+
+            REQUIRE(sorted_model.pop_finished == reference_model.pop_finished);
+            REQUIRE(sorted_model.get_active_agents() == reference_model.get_active_agents());
+            ModelState reference_state = reference_model.get_state();
+            ModelState sorted_state = sorted_model.get_state();
+            for (int i = 0; i < sorted_parameters.get_population_total(); i++) {
+                REQUIRE(sorted_state.agents_location[i].x == reference_state.agents_location[i].x);
+                REQUIRE(sorted_state.agents_location[i].y == reference_state.agents_location[i].y);
+                REQUIRE(sorted_state.agent_active_status[i] == reference_state.agent_active_status[i]);
+                REQUIRE(sorted_model.agents[i].get_history_collisions() ==
+                        reference_model.agents[i].get_history_collisions());
+            }
+
+            std::vector<Point2D> reference_trajectory =
+                reference_model.get_trajectory_recorder().get_agent_trajectory(42);
+            std::vector<Point2D> sorted_trajectory = sorted_model.get_trajectory_recorder().get_agent_trajectory(42);
+            REQUIRE(sorted_trajectory.size() == reference_trajectory.size());
+            for (unsigned long j = 0; j < reference_trajectory.size(); j++) {
+                REQUIRE(sorted_trajectory[j].x == reference_trajectory[j].x);
+                REQUIRE(sorted_trajectory[j].y == reference_trajectory[j].y);
+            }
+        }
+    }
+
+    SECTION("Test free flowing agents move as when every move is tested") {
+        ModelParameters free_flow_parameters;
+        free_flow_parameters.set_population_total(100);
+        free_flow_parameters.set_do_print(false);
+        free_flow_parameters.set_random_seed(3);
+
+        for (AgentUpdateMode mode : {AgentUpdateMode::sequential, AgentUpdateMode::synchronous}) {
+            free_flow_parameters.set_agent_update_mode(mode);
+            free_flow_parameters.set_free_flow_steps(0);
+            Model reference_model(0, free_flow_parameters);
+            free_flow_parameters.set_free_flow_steps(3);
+            Model free_flow_model(0, free_flow_parameters);
+
+            int free_flow_moves = 0;
+            for (int i = 0; i < 600; i++) {
+                reference_model.step();
+                free_flow_model.step();
+                for (int agent_id : free_flow_model.get_active_agents()) {
+                    free_flow_moves += free_flow_model.is_free_flowing(agent_id);
+                }
+            }
+            REQUIRE(free_flow_moves > 0);
+
+            REQUIRE(free_flow_model.pop_finished == reference_model.pop_finished);
+            REQUIRE(free_flow_model.get_active_agents() == reference_model.get_active_agents());
+            REQUIRE(free_flow_model.steps_taken == reference_model.steps_taken);
+            REQUIRE(free_flow_model.steps_delay == reference_model.steps_delay);
+            ModelState reference_state = reference_model.get_state();
+            ModelState free_flow_state = free_flow_model.get_state();
+            for (int i = 0; i < free_flow_parameters.get_population_total(); i++) {
+                REQUIRE(free_flow_state.agents_location[i].x == reference_state.agents_location[i].x);
+                REQUIRE(free_flow_state.agents_location[i].y == reference_state.agents_location[i].y);
+                REQUIRE(free_flow_state.agent_active_status[i] == reference_state.agent_active_status[i]);
+                REQUIRE(free_flow_model.agents[i].get_history_collisions() ==
+                        reference_model.agents[i].get_history_collisions());
+                REQUIRE(free_flow_model.agents[i].get_history_wiggles() ==
+                        reference_model.agents[i].get_history_wiggles());
+            }
+        }
+    }
+
+    SECTION("Test advancing a model runs the same steps as stepping it") {
+        ModelParameters advance_parameters;
+        advance_parameters.set_population_total(100);
+        advance_parameters.set_do_print(false);
+        advance_parameters.set_step_limit(500);
+        Model stepped_model(0, advance_parameters);
+        Model advanced_model(0, advance_parameters);
+
+        for (int i = 0; i < 120; i++) {
+            stepped_model.step();
+        }
+        advanced_model.advance(50);
+        advanced_model.advance(70);
+        REQUIRE(advanced_model.step_id == stepped_model.step_id);
+        REQUIRE(advanced_model.pop_finished == stepped_model.pop_finished);
+        ModelState stepped_state = stepped_model.get_state();
+        ModelState advanced_state = advanced_model.get_state();
+        for (int i = 0; i < advance_parameters.get_population_total(); i++) {
+            REQUIRE(advanced_state.agents_location[i].x == stepped_state.agents_location[i].x);
+            REQUIRE(advanced_state.agents_location[i].y == stepped_state.agents_location[i].y);
+        }
+        REQUIRE(advanced_model.get_trajectory_recorder().get_frames_number() ==
+                stepped_model.get_trajectory_recorder().get_frames_number());
+
+        // The model stops at the step limit
+        advanced_model.advance(1000);
+        REQUIRE(advanced_model.step_id == advance_parameters.get_step_limit());
+    }
+
+    SECTION("Test the time step scales the moves and the time of the model") {
+        ModelParameters time_parameters;
+        time_parameters.set_population_total(1);
+        time_parameters.set_do_print(false);
+        time_parameters.set_agents_locations({Point2D(10, 50)});
+        time_parameters.set_step_limit(100);
+        Model unit_model(0, time_parameters);
+        time_parameters.set_time_step(0.5);
+        Model half_model(0, time_parameters);
+
+        int steps_activate = unit_model.get_agent_store().cold_data[0].steps_activate;
+        unit_model.advance(steps_activate + 1);
+        half_model.advance(2 * steps_activate + 1);
+        REQUIRE(half_model.get_time() == Approx(steps_activate + 0.5));
+        const Point2D &unit_location = unit_model.agents[0].get_agent_location();
+        const Point2D &half_location = half_model.agents[0].get_agent_location();
+        REQUIRE(half_location.x - 10 == Approx((unit_location.x - 10) / 2).margin(1.0e-4));
+        REQUIRE(half_location.y - 50 == Approx((unit_location.y - 50) / 2).margin(1.0e-4));
+
+        // The step limit is in time units
+        time_parameters.set_agents_locations({});
+        time_parameters.set_population_total(100);
+        time_parameters.set_time_step(2);
+        Model double_model(0, time_parameters);
+        double_model.advance(1000);
+        REQUIRE(double_model.get_time() <= 100);
+        REQUIRE(double_model.step_id <= 50);
+        REQUIRE(double_model.get_trajectory_recorder().get_frame_time(10) == 20);
+    }
+
+    SECTION("Test the adaptive time step is finer in crowded stations") {
+        ModelParameters adaptive_parameters;
+        adaptive_parameters.set_population_total(300);
+        adaptive_parameters.set_do_print(false);
+        adaptive_parameters.set_time_step(4);
+        adaptive_parameters.set_min_time_step(0.5);
+        adaptive_parameters.set_adaptive_time_step(true);
+        Model adaptive_model(0, adaptive_parameters);
+
+        float min_time_step = 4;
+        float max_time_step = 0;
+        while (adaptive_model.is_active() && !adaptive_model.model_simulation_finished()) {
+            int step_id = adaptive_model.step_id;
+            double time = adaptive_model.get_time();
+            adaptive_model.step();
+            if (adaptive_model.step_id > step_id) {
+                REQUIRE(adaptive_model.get_time() == time + adaptive_model.get_time_step());
+                min_time_step = std::fmin(min_time_step, adaptive_model.get_time_step());
+                max_time_step = std::fmax(max_time_step, adaptive_model.get_time_step());
+            }
+        }
+        REQUIRE(min_time_step == 0.5);
+        REQUIRE(max_time_step == 4);
+        REQUIRE(adaptive_model.get_time() <= adaptive_parameters.get_step_limit());
+
+        adaptive_parameters.set_min_time_step(8);
+        REQUIRE_THROWS_AS(Model(0, adaptive_parameters), std::invalid_argument);
+    }
+
+    SECTION("Test a reset model runs as a new model") {
+        ModelParameters reset_parameters;
+        reset_parameters.set_population_total(150);
+        reset_parameters.set_do_print(false);
+        reset_parameters.set_neighbour_search_type(NeighbourSearchType::verlet_list);
+        reset_parameters.set_reorder_period(10);
+        reset_parameters.set_free_flow_steps(4);
+        Model reset_model(0, reset_parameters);
+        reset_model.advance(300);
+
+        auto require_same_run = [](Model &model, Model &new_model, int population_total) {
+            for (int i = 0; i < 300; i++) {
+                model.step();
+                new_model.step();
+            }
+            REQUIRE(model.pop_active == new_model.pop_active);
+            REQUIRE(model.pop_finished == new_model.pop_finished);
+            REQUIRE(model.get_history_collisions_number() == new_model.get_history_collisions_number());
+            ModelState state = model.get_state();
+            ModelState new_state = new_model.get_state();
+            REQUIRE(state.agents_location.size() == static_cast<unsigned long>(population_total));
+            for (int i = 0; i < population_total; i++) {
+                REQUIRE(state.agents_location[i].x == new_state.agents_location[i].x);
+                REQUIRE(state.agents_location[i].y == new_state.agents_location[i].y);
+                REQUIRE(state.agent_active_status[i] == new_state.agent_active_status[i]);
+            }
+            REQUIRE(model.get_trajectory_recorder().get_frames_number() ==
+                    new_model.get_trajectory_recorder().get_frames_number());
+        };
+
+        // With a new seed
+        reset_model.reset(7);
+        reset_parameters.set_random_seed(7);
+        Model new_model(0, reset_parameters);
+        require_same_run(reset_model, new_model, 150);
+
+        // With a larger population and another neighbour search
+        reset_parameters.set_population_total(250);
+        reset_parameters.set_neighbour_search_type(NeighbourSearchType::uniform_grid);
+        reset_parameters.set_random_seed(9);
+        reset_model.reset(reset_parameters);
+        Model larger_model(0, reset_parameters);
+        require_same_run(reset_model, larger_model, 250);
+
+        // With a smaller population
+        reset_parameters.set_population_total(80);
+        reset_model.reset(reset_parameters);
+        Model smaller_model(0, reset_parameters);
+        require_same_run(reset_model, smaller_model, 80);
+    }
+
+    SECTION("Test the state view reads the state of the model in id order") {
+        ModelParameters sorted_parameters;
+        sorted_parameters.set_population_total(200);
+        sorted_parameters.set_do_print(false);
+        sorted_parameters.set_reorder_period(5);
+        Model sorted_model(0, sorted_parameters);
+        for (int i = 0; i < 100; i++) {
+            sorted_model.step();
+        }
+
+        ModelState state = sorted_model.get_state();
+        ModelStateView view = sorted_model.get_state_view();
+        REQUIRE(view.size() == state.agents_location.size());
+        for (unsigned long i = 0; i < view.size(); i++) {
+            REQUIRE(view.agent_location(i).x == state.agents_location[i].x);
+            REQUIRE(view.agent_location(i).y == state.agents_location[i].y);
+            REQUIRE(view.agent_status(i) == state.agent_active_status[i]);
+            REQUIRE(view.agent_desired_location(i).x == state.agents_desired_location[i].x);
+        }
+
+        // The view is not a copy
+        sorted_model.perturb_state(1);
+        ModelState perturbed_state = view.to_state();
+        REQUIRE(perturbed_state.agents_location[3].x == sorted_model.get_state().agents_location[3].x);
+        REQUIRE(perturbed_state.agents_location[3].x != state.agents_location[3].x);
+    }
+
+    SECTION("Test a packed state is unpacked as it was") {
+        ModelParameters packed_parameters;
+        packed_parameters.set_population_total(50);
+        packed_parameters.set_do_print(false);
+        Model packed_model(0, packed_parameters);
+        for (int i = 0; i < 60; i++) {
+            packed_model.step();
+        }
+
+        // Two states in one buffer, unpacked into empty states
+        ModelState state = packed_model.get_state();
+        std::vector<char> buffer;
+        state.pack(buffer);
+        model.get_state().pack(buffer);
+        ModelState unpacked_state;
+        std::size_t position = unpacked_state.unpack(buffer, 0);
+        ModelState second_state;
+        REQUIRE(second_state.unpack(buffer, position) == buffer.size());
+
+        REQUIRE(unpacked_state.agents_location.size() == state.agents_location.size());
+        for (unsigned long i = 0; i < state.agents_location.size(); i++) {
+            REQUIRE(unpacked_state.agents_location[i].x == state.agents_location[i].x);
+            REQUIRE(unpacked_state.agents_location[i].y == state.agents_location[i].y);
+            REQUIRE(unpacked_state.agent_active_status[i] == state.agent_active_status[i]);
+            REQUIRE(unpacked_state.agents_desired_location[i].y == state.agents_desired_location[i].y);
+        }
+        REQUIRE(second_state.agents_location.size() == model.get_state().agents_location.size());
+    }
 }
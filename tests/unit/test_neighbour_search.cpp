@@ -0,0 +1,139 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "catch.hpp"
+#include "Model.hpp"
+#include "ModelParameters.hpp"
+#include "NeighbourSearch.hpp"
+
+using namespace station_sim;
+
+TEST_CASE("Test NeighbourSearch") {
+    ModelParameters model_parameters;
+    model_parameters.set_population_total(300);
+    model_parameters.set_do_print(false);
+    Model model(0, model_parameters);
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> location_distribution(0, 25);
+    std::uniform_int_distribution<int> status_distribution(0, 2);
+
+    for (Agent &agent : model.agents) {
+        agent.set_agent_location(Point2D(location_distribution(generator), location_distribution(generator)));
+        agent.set_status(static_cast<AgentStatus>(status_distribution(generator)));
+    }
+
+    float separation = model_parameters.get_separation();
+    BruteForceNeighbourSearch brute_force(separation);
+    std::vector<std::unique_ptr<NeighbourSearch>> backends;
+    backends.push_back(NeighbourSearch::create(NeighbourSearchType::uniform_grid, separation));
+    backends.push_back(NeighbourSearch::create(NeighbourSearchType::sorted_sweep, separation));
+    backends.push_back(NeighbourSearch::create(NeighbourSearchType::verlet_list, separation));
+
+    SECTION("Same collisions as the brute-force scan") {
+        for (auto &backend : backends) {
+            backend->rebuild(model.get_agent_store());
+        }
+
+        for (int i = 0; i < 2000; i++) {
+            int agent_id = i % model_parameters.get_population_total();
+            Point2D location(location_distribution(generator), location_distribution(generator));
+            bool expected = brute_force.collides(model.get_agent_store(), agent_id, location);
+            for (auto &backend : backends) {
+                REQUIRE(backend->collides(model.get_agent_store(), agent_id, location) == expected);
+            }
+        }
+    }
+
+    SECTION("Same collisions after agents move") {
+        for (auto &backend : backends) {
+            backend->rebuild(model.get_agent_store());
+        }
+
+        std::uniform_real_distribution<float> move_distribution(-1.5, 1.5);
+        for (int i = 0; i < 2000; i++) {
+            int agent_id = i % model_parameters.get_population_total();
+            Agent &agent = model.agents.at(agent_id);
+            Point2D old_location = agent.get_agent_location();
+            Point2D new_location(old_location.x + move_distribution(generator),
+                                 old_location.y + move_distribution(generator));
+            for (auto &backend : backends) {
+                backend->update(agent_id, old_location, new_location);
+            }
+            agent.set_agent_location(new_location);
+
+            // Query exactly at the separation distance behind the moved agent
+            Point2D location(new_location.x - separation, new_location.y);
+            bool expected = brute_force.collides(model.get_agent_store(), -1, location);
+            if (agent.getStatus() == AgentStatus::active) {
+                REQUIRE(expected);
+            }
+            for (auto &backend : backends) {
+                REQUIRE(backend->collides(model.get_agent_store(), -1, location) == expected);
+            }
+        }
+    }
+
+    SECTION("Same collisions around the moving agents with reused Verlet lists") {
+        VerletListNeighbourSearch verlet_lists(separation, 2);
+        verlet_lists.rebuild(model.get_agent_store());
+
+        std::uniform_real_distribution<float> move_distribution(-0.3f, 0.3f);
+        int rebuilds_number = 1;
+        for (int i = 0; i < 6000; i++) {
+            int agent_id = i % model_parameters.get_population_total();
+            Agent &agent = model.agents.at(agent_id);
+            Point2D old_location = agent.get_agent_location();
+            Point2D new_location(old_location.x + move_distribution(generator),
+                                 old_location.y + move_distribution(generator));
+            verlet_lists.update(agent_id, old_location, new_location);
+            agent.set_agent_location(new_location);
+
+            // Query a move of the agent, as `Agent::collides_other_agent` does
+            Point2D location(new_location.x + move_distribution(generator),
+                             new_location.y + move_distribution(generator));
+            REQUIRE(verlet_lists.collides(model.get_agent_store(), agent_id, location) ==
+                    brute_force.collides(model.get_agent_store(), agent_id, location));
+
+            // As the model, rebuild the index once all the agents have moved
+            if (agent_id == model_parameters.get_population_total() - 1) {
+                verlet_lists.rebuild(model.get_agent_store());
+                rebuilds_number++;
+            }
+        }
+        REQUIRE(verlet_lists.get_lists_builds_number() > 1);
+        REQUIRE(verlet_lists.get_lists_builds_number() < static_cast<unsigned long>(rebuilds_number));
+    }
+
+    SECTION("Same candidates as the brute-force scan") {
+        for (auto &backend : backends) {
+            backend->rebuild(model.get_agent_store());
+        }
+
+        std::uniform_real_distribution<float> radius_distribution(0, 8);
+        std::vector<int> expected;
+        std::vector<int> candidates;
+        for (int i = 0; i < 500; i++) {
+            int agent_id = i % model_parameters.get_population_total();
+            Point2D location(location_distribution(generator), location_distribution(generator));
+            double radius = static_cast<double>(radius_distribution(generator));
+            brute_force.find_candidates(model.get_agent_store(), agent_id, location, radius, expected);
+            for (auto &backend : backends) {
+                backend->find_candidates(model.get_agent_store(), agent_id, location, radius, candidates);
+                std::sort(candidates.begin(), candidates.end());
+                REQUIRE(candidates == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,148 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_RUNNER
+
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+#include "ParticleFilter.hpp"
+#include "ParticleState.hpp"
+#include "mpi.h"
+
+using namespace particle_filter;
+
+// Run with any number of ranks, e.g. `mpiexec -n 3 test_particle_filter`
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int result = Catch::Session().run(argc, argv);
+    MPI_Finalize();
+    return result;
+}
+
+namespace {
+    class TestState : public ParticleState {
+      public:
+        float x = 0;
+
+        void pack(std::vector<char> &buffer) const override { pack_value(buffer, x); }
+
+        std::size_t unpack(const std::vector<char> &buffer, std::size_t position) override {
+            return unpack_value(buffer, position, x);
+        }
+    };
+
+    class TestParticle {
+      public:
+        TestState state;
+
+        [[nodiscard]] TestState get_state() const { return state; }
+        void set_state(const TestState &value) { state = value; }
+    };
+
+    class TestDataFeed : public ParticleFilterDataFeed<TestState> {
+      public:
+        void progress_feed(int) override {}
+        [[nodiscard]] TestState get_state() override { return TestState(); }
+        void print_statistics() override {}
+    };
+
+    // Particle `i` of all the ranks starts at `x = i`. The initialiser keeps
+    // the particles, so that the test can read them.
+    class TestParticlesInitialiser : public ParticlesInitialiser<TestParticle> {
+      public:
+        mutable std::shared_ptr<std::vector<TestParticle>> particles;
+
+        [[nodiscard]] std::shared_ptr<std::vector<TestParticle>>
+        initialise_particles(int number_of_particles) const override {
+            int rank;
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            particles = std::make_shared<std::vector<TestParticle>>(number_of_particles);
+            for (int i = 0; i < number_of_particles; i++) {
+                (*particles)[i].state.x = static_cast<float>(rank * number_of_particles + i);
+            }
+            return particles;
+        }
+    };
+
+    float test_fit(float x) { return static_cast<float>(1 + static_cast<int>(x) % 4); }
+
+    class TestParticleFit : public ParticleFit<TestParticle, TestState> {
+      public:
+        [[nodiscard]] float calculate_particle_fit(const TestParticle &particle, const TestState &) const override {
+            return test_fit(particle.state.x);
+        }
+    };
+
+    std::vector<float> all_locations(const std::vector<TestParticle> &particles) {
+        int ranks_number;
+        MPI_Comm_size(MPI_COMM_WORLD, &ranks_number);
+        std::vector<float> locations;
+        for (const TestParticle &particle : particles) {
+            locations.push_back(particle.state.x);
+        }
+        std::vector<float> gathered_locations(locations.size() * static_cast<unsigned long>(ranks_number));
+        MPI_Allgather(locations.data(), static_cast<int>(locations.size()), MPI_FLOAT, gathered_locations.data(),
+                      static_cast<int>(locations.size()), MPI_FLOAT, MPI_COMM_WORLD);
+        return gathered_locations;
+    }
+
+    // The particles of all the ranks are systematically resampled from the
+    // fits, so the particles at a location get its expected copies within
+    // one copy each
+    void require_resampled_together(ParticleFilter<TestParticle, TestState> &particle_filter,
+                                    const std::vector<TestParticle> &particles) {
+        for (int window = 0; window < 30; window++) {
+            std::vector<float> locations = all_locations(particles);
+            std::map<float, int> particles_at;
+            double fits_sum = 0;
+            for (float x : locations) {
+                particles_at[x]++;
+                fits_sum += test_fit(x);
+            }
+
+            particle_filter.reweight();
+            particle_filter.resample();
+
+            std::map<float, int> copies_at;
+            for (float x : all_locations(particles)) {
+                REQUIRE(particles_at.count(x) == 1);
+                copies_at[x]++;
+            }
+            for (const auto &[x, particles_number] : particles_at) {
+                double expected_copies = locations.size() * particles_number * test_fit(x) / fits_sum;
+                REQUIRE(std::abs(copies_at[x] - expected_copies) < particles_number);
+            }
+        }
+    }
+} // namespace
+
+TEST_CASE("Test ParticleFilter") {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int ranks_number;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks_number);
+
+    auto particles_initialiser = std::make_shared<TestParticlesInitialiser>();
+    ParticleFilter<TestParticle, TestState> particle_filter(
+        std::make_shared<TestDataFeed>(), particles_initialiser, std::make_shared<TestParticleFit>(), nullptr,
+        40 * ranks_number, 1, 1);
+
+    SECTION("Test the ranks resample the particles together with the random seed") {
+        require_resampled_together(particle_filter, *particles_initialiser->particles);
+    }
+
+    SECTION("Test the ranks resample the particles together with the seed of rank 0") {
+        particle_filter.set_random_seed(static_cast<std::uint32_t>(100 + rank));
+        require_resampled_together(particle_filter, *particles_initialiser->particles);
+    }
+}
@@ -0,0 +1,112 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "catch.hpp"
+#include "ParticleRedistribution.hpp"
+
+using namespace particle_filter;
+
+TEST_CASE("Test ParticleRedistribution") {
+
+    SECTION("Test the copies stay on their rank when it has room for them") {
+        // Three ranks of two particles
+        std::vector<int> counts = {2, 0, 0, 2, 1, 1};
+        ParticleRedistribution particle_redistribution(counts, 2);
+        REQUIRE(particle_redistribution.get_transfers().empty());
+
+        std::vector<int> indexes;
+        particle_redistribution.place_copies(0, indexes);
+        REQUIRE(indexes == std::vector<int>{0, 0});
+        particle_redistribution.place_copies(1, indexes);
+        REQUIRE(indexes == std::vector<int>{3, 3});
+        particle_redistribution.place_copies(2, indexes);
+        REQUIRE(indexes == std::vector<int>{4, 5});
+    }
+
+    SECTION("Test a particle is sent once to each rank") {
+        std::vector<int> counts = {0, 0, 9, 0, 0, 0, 0, 0, 0};
+        ParticleRedistribution particle_redistribution(counts, 3);
+
+        const std::vector<ParticleTransfer> &transfers = particle_redistribution.get_transfers();
+        REQUIRE(transfers.size() == 2);
+        REQUIRE(transfers[0].source == 2);
+        REQUIRE(transfers[0].rank_destination == 1);
+        REQUIRE(transfers[0].copies == 3);
+        REQUIRE(transfers[1].rank_destination == 2);
+        REQUIRE(transfers[1].copies == 3);
+
+        std::vector<int> indexes;
+        for (int rank = 0; rank < 3; rank++) {
+            particle_redistribution.place_copies(rank, indexes);
+            REQUIRE(indexes == std::vector<int>{2, 2, 2});
+        }
+    }
+
+    SECTION("Test every rank gets its particles and every particle its copies") {
+        int particles_per_rank = 50;
+        int ranks_number = 4;
+        std::vector<int> counts(static_cast<unsigned long>(particles_per_rank * ranks_number), 0);
+        for (int copy = 0; copy < particles_per_rank * ranks_number; copy++) {
+            counts[(copy * copy * 7) % 37 + (copy % 3) * 60]++;
+        }
+        ParticleRedistribution particle_redistribution(counts, particles_per_rank);
+
+        std::set<std::pair<int, int>> sent_particles;
+        int sent_copies = 0;
+        for (const ParticleTransfer &transfer : particle_redistribution.get_transfers()) {
+            REQUIRE(transfer.copies > 0);
+            REQUIRE(transfer.source / particles_per_rank != transfer.rank_destination);
+            REQUIRE(sent_particles.insert({transfer.source, transfer.rank_destination}).second);
+            sent_copies += transfer.copies;
+        }
+
+        // Only the copies which do not fit on their rank are sent
+        int excess_copies = 0;
+        for (int rank = 0; rank < ranks_number; rank++) {
+            int rank_copies = 0;
+            for (int i = rank * particles_per_rank; i < (rank + 1) * particles_per_rank; i++) {
+                rank_copies += counts[i];
+            }
+            excess_copies += std::max(rank_copies - particles_per_rank, 0);
+        }
+        REQUIRE(sent_copies == excess_copies);
+
+        std::vector<int> placed_counts(counts.size(), 0);
+        for (int rank = 0; rank < ranks_number; rank++) {
+            std::vector<int> indexes;
+            particle_redistribution.place_copies(rank, indexes);
+            REQUIRE(indexes.size() == static_cast<unsigned long>(particles_per_rank));
+            for (int i = 0; i < particles_per_rank; i++) {
+                int particle = rank * particles_per_rank + i;
+                if (counts[particle] > 0) {
+                    REQUIRE(indexes[i] == particle);
+                }
+                placed_counts[indexes[i]]++;
+            }
+        }
+        REQUIRE(placed_counts == counts);
+    }
+
+    SECTION("Test the counts must hold whole ranks") {
+        REQUIRE_THROWS_AS(ParticleRedistribution(std::vector<int>(5, 1), 2), std::invalid_argument);
+        REQUIRE_THROWS_AS(ParticleRedistribution(std::vector<int>(4, 1), 0), std::invalid_argument);
+    }
+
+    SECTION("Test the counts must add up to the particles") {
+        REQUIRE_THROWS_AS(ParticleRedistribution(std::vector<int>{3, 0, 0, 0}, 2), std::invalid_argument);
+        REQUIRE_THROWS_AS(ParticleRedistribution(std::vector<int>{4, 2, 0, 0}, 2), std::invalid_argument);
+        REQUIRE_THROWS_AS(ParticleRedistribution(std::vector<int>{2, 3, 0, -1}, 2), std::invalid_argument);
+    }
+}
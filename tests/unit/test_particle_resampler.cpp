@@ -0,0 +1,128 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_RUNNER
+
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "catch.hpp"
+#include "ParticleResampler.hpp"
+#include "mpi.h"
+
+using namespace particle_filter;
+
+// Run with any number of ranks, e.g. `mpiexec -n 3 test_particle_resampler`
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int result = Catch::Session().run(argc, argv);
+    MPI_Finalize();
+    return result;
+}
+
+TEST_CASE("Test ParticleResampler") {
+    std::vector<std::shared_ptr<ParticleResampler>> resamplers = {
+        std::make_shared<MultinomialResampler>(), std::make_shared<StratifiedResampler>(),
+        std::make_shared<SystematicResampler>(), std::make_shared<ResidualResampler>()};
+
+    // Small integer weights, whose sums are exact whatever their order
+    std::vector<float> weights(1000);
+    for (unsigned long i = 0; i < weights.size(); i++) {
+        weights[i] = static_cast<float>((i * 7) % 11);
+    }
+
+    SECTION("Test the resampled particles are as many as the particles") {
+        for (const auto &resampler : resamplers) {
+            for (std::uint32_t window = 0; window < 20; window++) {
+                std::vector<int> counts;
+                resampler->draw_counts(weights, MPI_COMM_SELF, 5, window, counts);
+                REQUIRE(counts.size() == weights.size());
+                REQUIRE(std::accumulate(counts.begin(), counts.end(), 0) == static_cast<int>(weights.size()));
+                for (unsigned long i = 0; i < weights.size(); i++) {
+                    if (weights[i] == 0) {
+                        REQUIRE(counts[i] == 0);
+                    }
+                }
+            }
+        }
+    }
+
+    SECTION("Test the systematic and residual copies are close to the expected copies") {
+        double mean_weight = std::accumulate(weights.begin(), weights.end(), 0.0) / weights.size();
+        for (const auto &resampler : {resamplers[2], resamplers[3]}) {
+            std::vector<int> counts;
+            resampler->draw_counts(weights, MPI_COMM_SELF, 5, 0, counts);
+            for (unsigned long i = 0; i < weights.size(); i++) {
+                double expected_copies = weights[i] / mean_weight;
+                REQUIRE(counts[i] >= std::floor(expected_copies));
+                REQUIRE(counts[i] <= std::floor(expected_copies) + 1);
+            }
+        }
+    }
+
+    SECTION("Test the copies are drawn in proportion to the weights") {
+        for (const auto &resampler : resamplers) {
+            std::vector<double> mean_counts(weights.size(), 0);
+            int windows = 200;
+            for (int window = 0; window < windows; window++) {
+                std::vector<int> counts;
+                resampler->draw_counts(weights, MPI_COMM_SELF, 9, static_cast<std::uint32_t>(window), counts);
+                for (unsigned long i = 0; i < weights.size(); i++) {
+                    mean_counts[i] += static_cast<double>(counts[i]) / windows;
+                }
+            }
+
+            // Over the particles of each weight
+            double mean_weight = std::accumulate(weights.begin(), weights.end(), 0.0) / weights.size();
+            for (int weight = 0; weight < 11; weight++) {
+                double copies = 0;
+                int particles = 0;
+                for (unsigned long i = 0; i < weights.size(); i++) {
+                    if (weights[i] == static_cast<float>(weight)) {
+                        copies += mean_counts[i];
+                        particles++;
+                    }
+                }
+                REQUIRE(copies / particles == Approx(weight / mean_weight).margin(0.05));
+            }
+        }
+    }
+
+    SECTION("Test the ranks draw the copies drawn by a single rank") {
+        int rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        int ranks_number;
+        MPI_Comm_size(MPI_COMM_WORLD, &ranks_number);
+
+        std::vector<float> all_weights(static_cast<unsigned long>(ranks_number) * 300);
+        for (unsigned long i = 0; i < all_weights.size(); i++) {
+            all_weights[i] = static_cast<float>((i * 5) % 13);
+        }
+        std::vector<float> rank_weights(all_weights.begin() + rank * 300, all_weights.begin() + (rank + 1) * 300);
+
+        for (const auto &resampler : resamplers) {
+            std::vector<int> counts;
+            resampler->draw_counts(all_weights, MPI_COMM_SELF, 3, 1, counts);
+            std::vector<int> rank_counts;
+            resampler->draw_counts(rank_weights, MPI_COMM_WORLD, 3, 1, rank_counts);
+
+            std::vector<int> gathered_counts(all_weights.size());
+            MPI_Allgather(rank_counts.data(), 300, MPI_INT, gathered_counts.data(), 300, MPI_INT, MPI_COMM_WORLD);
+            REQUIRE(gathered_counts == counts);
+        }
+    }
+
+    SECTION("Test the kept particles keep their own state") {
+        std::vector<int> counts = {0, 3, 1, 0, 0, 2};
+        std::vector<int> indexes;
+        ParticleResampler::place_copies(counts, indexes);
+        REQUIRE(indexes == std::vector<int>{1, 1, 2, 1, 5, 5});
+    }
+}
@@ -0,0 +1,62 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <memory>
+#include <stdexcept>
+
+#include "catch.hpp"
+#include "Model.hpp"
+#include "ModelParameters.hpp"
+#include "Scenario.hpp"
+
+using namespace station_sim;
+
+TEST_CASE("Test Scenario") {
+
+    SECTION("Test the derived data is computed from the parameters") {
+        ModelParameters model_parameters;
+        std::shared_ptr<const Scenario> scenario = Scenario::create(model_parameters);
+
+        REQUIRE(scenario->get_speed_step() ==
+                (model_parameters.get_speed_mean() - model_parameters.get_speed_min()) /
+                    static_cast<float>(model_parameters.get_speed_steps()));
+        REQUIRE(scenario->get_gates_in_locations().size() == model_parameters.get_gates_in().size());
+        REQUIRE(scenario->get_gates_out_locations()[1].y == model_parameters.get_gates_out()[1].position.y);
+    }
+
+    SECTION("Test inconsistent parameters are rejected") {
+        ModelParameters model_parameters;
+        model_parameters.set_boundaries({Point2D(0, 0), Point2D(0, 100)});
+        REQUIRE_THROWS_AS(Scenario(model_parameters), std::invalid_argument);
+
+        model_parameters = ModelParameters();
+        model_parameters.set_gates_out({});
+        REQUIRE_THROWS_AS(Scenario(model_parameters), std::invalid_argument);
+
+        model_parameters = ModelParameters();
+        model_parameters.set_speed_mean(model_parameters.get_speed_min());
+        REQUIRE_THROWS_AS(Scenario(model_parameters), std::invalid_argument);
+    }
+
+    SECTION("Test models and their particles share the scenario") {
+        ModelParameters model_parameters;
+        model_parameters.set_do_print(false);
+        std::shared_ptr<const Scenario> scenario = Scenario::create(model_parameters);
+
+        Model model_a(0, scenario);
+        Model model_b(1, scenario);
+        Model particle = model_a.clone_particle();
+        REQUIRE(&model_a.get_scenario() == scenario.get());
+        REQUIRE(&model_b.get_scenario() == scenario.get());
+        REQUIRE(&particle.get_scenario() == scenario.get());
+        REQUIRE(model_a.is_do_history());
+        REQUIRE_FALSE(particle.is_do_history());
+    }
+}
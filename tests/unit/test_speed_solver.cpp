@@ -0,0 +1,91 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <memory>
+#include <random>
+
+#include "catch.hpp"
+#include "Agent.hpp"
+#include "Model.hpp"
+#include "ModelParameters.hpp"
+#include "SpeedSolver.hpp"
+
+using namespace station_sim;
+
+TEST_CASE("Test SpeedSolver") {
+    SECTION("Blocking interval of an agent ahead") {
+        double start, end;
+        SpeedSolver::agent_blocking_interval(Point2D(0, 0), Point2D(1, 0), Point2D(10, 0), 2, 0, start, end);
+        REQUIRE(start == Approx(8));
+        REQUIRE(end == Approx(10));
+
+        // Agents behind the location along the x axis never block it
+        SpeedSolver::agent_blocking_interval(Point2D(0, 0), Point2D(0, 1), Point2D(-1, 0), 2, 0, start, end);
+        REQUIRE(start > end);
+
+        // Moving backwards, the agent is blocked once it is behind the other
+        SpeedSolver::agent_blocking_interval(Point2D(0, 0), Point2D(-1, 0), Point2D(-10, 0), 2, 0, start, end);
+        REQUIRE(start == Approx(10));
+        REQUIRE(end == Approx(12));
+
+        // Moving away sideways
+        SpeedSolver::agent_blocking_interval(Point2D(0, 0), Point2D(0, 1), Point2D(1, 0), 2, 0, start, end);
+        REQUIRE(start == Approx(-std::sqrt(3.0)));
+        REQUIRE(end == Approx(std::sqrt(3.0)));
+    }
+
+    SECTION("Distance from the boundaries") {
+        StationGeometry station_geometry(
+            {Point2D(0, 0), Point2D(100, 0), Point2D(100, 50), Point2D(0, 50), Point2D(0, 0)}, {});
+        REQUIRE(SpeedSolver::boundaries_free_distance(station_geometry, Point2D(10, 25), Point2D(1, 0), 0.001) ==
+                Approx(89.999));
+        REQUIRE(SpeedSolver::boundaries_free_distance(station_geometry, Point2D(10, 25), Point2D(0, -0.5), 0.001) ==
+                Approx(49.998));
+        REQUIRE(SpeedSolver::boundaries_free_distance(station_geometry, Point2D(110, 25), Point2D(-1, 0), 0.001) ==
+                0);
+    }
+
+    SECTION("Same results as the exact tests") {
+        ModelParameters model_parameters;
+        model_parameters.set_population_total(300);
+        model_parameters.set_do_print(false);
+        Model model(0, model_parameters);
+
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> location_distribution(0, 25);
+        std::uniform_real_distribution<float> angle_distribution(-3.2f, 3.2f);
+        for (Agent &agent : model.agents) {
+            agent.set_agent_location(Point2D(location_distribution(generator), location_distribution(generator)));
+            agent.set_status(AgentStatus::active);
+        }
+
+        const AgentStore &agent_store = model.get_agent_store();
+        std::unique_ptr<NeighbourSearch> neighbour_search_pointer =
+            NeighbourSearch::create(NeighbourSearchType::uniform_grid, model_parameters.get_separation());
+        neighbour_search_pointer->rebuild(agent_store);
+        const NeighbourSearch &neighbour_search = *neighbour_search_pointer;
+        SpeedSolver speed_solver;
+        for (int i = 0; i < 1000; i++) {
+            int agent_id = i % model_parameters.get_population_total();
+            const Point2D &location = agent_store.locations[agent_id];
+            float angle = angle_distribution(generator);
+            Point2D direction(std::cos(angle), std::sin(angle));
+
+            speed_solver.solve(agent_store, neighbour_search, model.get_station_geometry(), agent_id, direction, 4,
+                               0.2f);
+            for (float speed = 4; speed > 0.2f; speed -= 0.05f) {
+                Point2D new_location(location.x + speed * direction.x, location.y + speed * direction.y);
+                bool expected = Agent::is_outside_boundaries(model.get_boundary_vertices(), new_location) ||
+                                neighbour_search.collides(agent_store, agent_id, new_location);
+                REQUIRE(speed_solver.is_blocked(speed, new_location) == expected);
+            }
+        }
+    }
+}
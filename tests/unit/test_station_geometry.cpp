@@ -0,0 +1,121 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <random>
+#include <vector>
+
+#include "catch.hpp"
+#include "Point2D.hpp"
+#include "StationGeometry.hpp"
+
+using namespace station_sim;
+
+namespace {
+    // Even-odd test over all the edges of all the rings
+    bool is_outside_all_edges(const std::vector<std::vector<Point2D>> &rings, const Point2D &location) {
+        bool inside = false;
+        for (const std::vector<Point2D> &vertices : rings) {
+            int len = static_cast<int>(vertices.size());
+            for (int i = 0, j = len - 1; i < len; j = i++) {
+                if (((vertices[i].y > location.y) != (vertices[j].y > location.y)) &&
+                    (location.x < vertices[i].x + (vertices[j].x - vertices[i].x) * (location.y - vertices[i].y) /
+                                                      (vertices[j].y - vertices[i].y))) {
+                    inside = !inside;
+                }
+            }
+        }
+        return !inside;
+    }
+} // namespace
+
+TEST_CASE("Test StationGeometry") {
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> location_distribution(-10, 210);
+
+    SECTION("Test a station with obstacles gives the same results as testing all the edges") {
+        std::vector<Point2D> boundary_vertices = {Point2D(0, 0),    Point2D(0, 100), Point2D(80, 120),
+                                                  Point2D(200, 100), Point2D(200, 0), Point2D(100, 20)};
+        std::vector<std::vector<Point2D>> obstacles = {
+            {Point2D(20, 20), Point2D(30, 20), Point2D(30, 30), Point2D(20, 30)},
+            {Point2D(120, 40), Point2D(150, 45), Point2D(135, 80)},
+        };
+        StationGeometry station_geometry(boundary_vertices, obstacles);
+        REQUIRE_FALSE(station_geometry.is_axis_aligned_rectangle());
+        REQUIRE(station_geometry.get_edges().size() == 13);
+
+        std::vector<std::vector<Point2D>> rings = obstacles;
+        rings.push_back(boundary_vertices);
+        for (int i = 0; i < 100000; i++) {
+            Point2D location(location_distribution(generator), location_distribution(generator));
+            REQUIRE(station_geometry.is_outside(location) == is_outside_all_edges(rings, location));
+        }
+
+        // Inside the pillar, on its edges and between the obstacles
+        REQUIRE(station_geometry.is_outside(Point2D(25, 25)));
+        REQUIRE(station_geometry.is_outside(Point2D(135, 50)));
+        REQUIRE_FALSE(station_geometry.is_outside(Point2D(60, 50)));
+        REQUIRE(station_geometry.is_outside(Point2D(100, 10)));
+    }
+
+    SECTION("Test the fast path of rectangles gives the same results as testing all the edges") {
+        std::vector<Point2D> boundary_vertices = {Point2D(0, 0), Point2D(0, 100), Point2D(200, 100),
+                                                  Point2D(200, 0), Point2D(0, 0)};
+        StationGeometry station_geometry(boundary_vertices, {});
+        REQUIRE(station_geometry.is_axis_aligned_rectangle());
+
+        for (int i = 0; i < 100000; i++) {
+            Point2D location(location_distribution(generator), location_distribution(generator));
+            REQUIRE(station_geometry.is_outside(location) == is_outside_all_edges({boundary_vertices}, location));
+        }
+        for (const Point2D &location : {Point2D(0, 0), Point2D(200, 50), Point2D(100, 100), Point2D(0, 100)}) {
+            REQUIRE(station_geometry.is_outside(location) == is_outside_all_edges({boundary_vertices}, location));
+        }
+
+        // Same vertices, but not a rectangle
+        StationGeometry folded_geometry({Point2D(0, 0), Point2D(200, 0), Point2D(200, 100), Point2D(200, 0)}, {});
+        REQUIRE_FALSE(folded_geometry.is_axis_aligned_rectangle());
+    }
+
+    SECTION("Test the raster gives the same results as the exact tests") {
+        std::vector<Point2D> boundary_vertices = {Point2D(0, 0),    Point2D(0, 100), Point2D(80, 120),
+                                                  Point2D(200, 100), Point2D(200, 0), Point2D(100, 20)};
+        std::vector<std::vector<Point2D>> obstacles = {
+            {Point2D(20, 20), Point2D(30, 20), Point2D(30, 30), Point2D(20, 30)},
+            {Point2D(120, 40), Point2D(150, 45), Point2D(135, 80)},
+        };
+        StationGeometry exact_geometry(boundary_vertices, obstacles);
+        for (float raster_cell_size : {0.5f, 3.0f}) {
+            StationGeometry raster_geometry(boundary_vertices, obstacles, raster_cell_size);
+            REQUIRE(raster_geometry.has_raster());
+
+            for (int i = 0; i < 100000; i++) {
+                Point2D location(location_distribution(generator), location_distribution(generator));
+                REQUIRE(raster_geometry.is_outside(location) == exact_geometry.is_outside(location));
+                Point2D raster_point = raster_geometry.closest_edge_point(location);
+                Point2D exact_point = exact_geometry.closest_edge_point(location);
+                REQUIRE(raster_point.x == exact_point.x);
+                REQUIRE(raster_point.y == exact_point.y);
+            }
+        }
+    }
+
+    SECTION("Test locations are moved to the closest edge, including the edges of the obstacles") {
+        StationGeometry station_geometry({Point2D(0, 0), Point2D(0, 100), Point2D(200, 100), Point2D(200, 0)},
+                                         {{Point2D(20, 20), Point2D(30, 20), Point2D(30, 30), Point2D(20, 30)}});
+
+        Point2D below = station_geometry.closest_edge_point(Point2D(50, -1));
+        REQUIRE(below.x == Approx(50));
+        REQUIRE(below.y == Approx(0));
+
+        Point2D in_pillar = station_geometry.closest_edge_point(Point2D(29, 25));
+        REQUIRE(in_pillar.x == Approx(30));
+        REQUIRE(in_pillar.y == Approx(25));
+    }
+}
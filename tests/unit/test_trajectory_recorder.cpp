@@ -0,0 +1,77 @@
+//---------------------------------------------------------------------------//
+// Copyright (c) 2020 Eleftherios Avramidis <ea461@cam.ac.uk>
+// Research Computing Services, University of Cambridge, UK
+//
+// Distributed under The MIT License (MIT)
+// See accompanying file LICENSE
+//---------------------------------------------------------------------------//
+
+#define CATCH_CONFIG_MAIN
+
+#include <vector>
+
+#include "catch.hpp"
+#include "Point2D.hpp"
+#include "TrajectoryRecorder.hpp"
+
+using namespace station_sim;
+
+namespace {
+    std::vector<Point2D> make_frame(unsigned long agents_number, int step) {
+        std::vector<Point2D> locations(agents_number);
+        for (unsigned long i = 0; i < agents_number; i++) {
+            locations[i] = Point2D(static_cast<float>(i), static_cast<float>(step));
+        }
+        return locations;
+    }
+} // namespace
+
+TEST_CASE("Test TrajectoryRecorder") {
+
+    SECTION("Test frames are recorded every stride steps") {
+        TrajectoryRecorder trajectory_recorder(10, 3, 0);
+        for (int step = 0; step < 10; step++) {
+            trajectory_recorder.record(step, make_frame(10, step));
+        }
+
+        REQUIRE(trajectory_recorder.get_frames_number() == 4);
+        REQUIRE(trajectory_recorder.get_frame_step(3) == 9);
+        REQUIRE(trajectory_recorder.get_frame_time(3) == 9);
+        REQUIRE(trajectory_recorder.get_frame(2)[7].x == 7);
+        REQUIRE(trajectory_recorder.get_frame(2)[7].y == 6);
+
+        std::vector<Point2D> trajectory = trajectory_recorder.get_agent_trajectory(4);
+        REQUIRE(trajectory.size() == 4);
+        for (unsigned long i = 0; i < trajectory.size(); i++) {
+            REQUIRE(trajectory[i].x == 4);
+            REQUIRE(trajectory[i].y == trajectory_recorder.get_frame_step(i));
+        }
+    }
+
+    SECTION("Test chunks over the memory limit are spilled and read back") {
+        // About six frames per chunk
+        unsigned long agents_number = 20000;
+        unsigned long memory_limit = 1 << 20;
+        TrajectoryRecorder trajectory_recorder(agents_number, 1, memory_limit);
+        for (int step = 0; step < 40; step++) {
+            trajectory_recorder.record(step, make_frame(agents_number, step));
+            REQUIRE(trajectory_recorder.get_memory_usage() <= 2 * memory_limit);
+        }
+
+        TrajectoryRecorder trajectory_recorder_copy(trajectory_recorder);
+        for (const TrajectoryRecorder *recorder : {&trajectory_recorder, &trajectory_recorder_copy}) {
+            REQUIRE(recorder->get_frames_number() == 40);
+            for (unsigned long frame = 0; frame < 40; frame++) {
+                std::vector<Point2D> locations = recorder->get_frame(frame);
+                REQUIRE(locations[123].x == 123);
+                REQUIRE(locations[123].y == static_cast<float>(frame));
+            }
+
+            std::vector<Point2D> trajectory = recorder->get_agent_trajectory(19999);
+            REQUIRE(trajectory.size() == 40);
+            REQUIRE(trajectory[0].y == 0);
+            REQUIRE(trajectory[39].x == 19999);
+            REQUIRE(trajectory[39].y == 39);
+        }
+    }
+}